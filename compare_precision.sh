@@ -0,0 +1,24 @@
+#!/bin/bash
+# Script to compare the double and single precision builds of the filter on
+# the same synthetic drive (pf_accuracy), as in the "Single Precision"
+# section of the writeup.
+#
+# Given parameters are passed over to pf_accuracy after the map file.
+# Example:
+#    * ./compare_precision.sh 16
+#
+
+# Go into the directory where this bash script is contained.
+cd `dirname $0`
+
+mkdir -p build build_float
+(cd build && cmake -DCMAKE_BUILD_TYPE=Release .. > /dev/null &&
+ make pf_accuracy > /dev/null) || exit 1
+(cd build_float &&
+ cmake -DCMAKE_BUILD_TYPE=Release -DPF_SINGLE_PRECISION=ON .. > /dev/null &&
+ make pf_accuracy > /dev/null) || exit 1
+
+echo "| Build  | Best particle error [m] | Weighted estimate error [m] | Time per frame [ms] |"
+echo "|--------|-------------------------|-----------------------------|---------------------|"
+./build/pf_accuracy data/map_data.txt $*
+./build_float/pf_accuracy data/map_data.txt $*
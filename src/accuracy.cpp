@@ -0,0 +1,157 @@
+/**
+ * accuracy.cpp
+ * Accuracy and speed of the filter on a synthetic drive over a map, as
+ * reported in the "Single Precision" section of the writeup. Build it in
+ * both precisions and run it on the same map to compare them (see
+ * compare_precision.sh).
+ *
+ * The drive is 400 frames at 5 m/s from the start pose of the simulator,
+ * alternating 4 s straight segments and 4 s turns at 0.15 rad/s (left and
+ * right in turn), with observations of the landmarks within 50 m corrupted
+ * by 0.3 m Gaussian noise. The filter is configured as by the server
+ * (filter_setup.h). Each seed draws other observations and another filter.
+ *
+ * Usage: pf_accuracy <map file> [seed count]
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "filter_setup.h"
+#include "helper_functions.h"
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+using std::vector;
+
+/**
+ * make_drive Simulates the drive: ground truth pose of every frame, and
+ *   controls from every frame to the next one.
+ */
+static void make_drive(vector<ground_truth> &gt, vector<control_s> &controls) {
+  int const num_frames = 400;
+  int const segment = 40;  // Frames of a straight segment or of a turn
+  double const delta_t = 0.1;
+  double const velocity = 5.0;
+  double const yaw_rate = 0.15;
+
+  ground_truth pose;
+  pose.x = 6.2785;
+  pose.y = 1.9598;
+  pose.theta = 0.0;
+  gt.clear();
+  controls.clear();
+  for (int t = 0; t < num_frames; ++t) {
+    gt.push_back(pose);
+    control_s control;
+    control.velocity = velocity;
+    int const phase = t / segment;
+    control.yawrate = phase % 2 == 0 ? 0.0 :
+                      (phase % 4 == 1 ? yaw_rate : -yaw_rate);
+    controls.push_back(control);
+
+    if (control.yawrate == 0.0) {
+      pose.x += velocity * delta_t * cos(pose.theta);
+      pose.y += velocity * delta_t * sin(pose.theta);
+    } else {
+      double const theta_end = pose.theta + control.yawrate * delta_t;
+      pose.x += velocity / control.yawrate * (sin(theta_end) - sin(pose.theta));
+      pose.y += velocity / control.yawrate * (cos(pose.theta) - cos(theta_end));
+      pose.theta = theta_end;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map file> [seed count]"
+              << std::endl;
+    return -1;
+  }
+  int const num_seeds = argc > 2 ? atoi(argv[2]) : 8;
+  if (num_seeds <= 0) {
+    std::cerr << "Error: The seed count must be positive" << std::endl;
+    return -1;
+  }
+
+  Map map;
+  if (!read_map_data(argv[1], map)) {
+    std::cerr << "Error: Could not open map file " << argv[1] << std::endl;
+    return -1;
+  }
+
+  double const delta_t = 0.1;
+  double const sensor_range = 50.0;
+  double sigma_pos[3] = {0.3, 0.3, 0.01};
+  double sigma_landmark[2] = {0.3, 0.3};
+
+  vector<ground_truth> gt;
+  vector<control_s> controls;
+  make_drive(gt, controls);
+
+  double best_error = 0.0;
+  double estimate_error = 0.0;
+  double seconds = 0.0;
+  size_t num_frames = 0;
+  for (int seed = 1; seed <= num_seeds; ++seed) {
+    std::default_random_engine gen(seed);
+    ParticleFilter pf;
+    setup_filter(pf, map, sensor_range);
+    pf.setPoseEstimation(true);
+    pf.seed(seed);
+
+    for (size_t t = 0; t < gt.size(); ++t) {
+      vector<LandmarkObs> const observations = make_synthetic_observations(
+          map, gt[t].x, gt[t].y, gt[t].theta, sensor_range, sigma_landmark,
+          gen);
+
+      std::chrono::steady_clock::time_point const start =
+          std::chrono::steady_clock::now();
+      if (t == 0) {
+        std::normal_distribution<double> noise_x(gt[t].x, sigma_pos[0]);
+        std::normal_distribution<double> noise_y(gt[t].y, sigma_pos[1]);
+        std::normal_distribution<double> noise_theta(gt[t].theta,
+                                                     sigma_pos[2]);
+        pf.init(noise_x(gen), noise_y(gen), noise_theta(gen), sigma_pos);
+      } else {
+        pf.prediction(delta_t, sigma_pos, controls[t - 1].velocity,
+                      controls[t - 1].yawrate);
+      }
+      pf.updateWeights(sensor_range, sigma_landmark, observations, map);
+      std::chrono::steady_clock::time_point const updated =
+          std::chrono::steady_clock::now();
+
+      // Errors before resampling, where the server reports them
+      const Particle *best = &pf.particles[0];
+      for (size_t i = 1; i < pf.particles.size(); ++i) {
+        if (pf.particles[i].weight > best->weight) {
+          best = &pf.particles[i];
+        }
+      }
+      best_error += fabs(best->x - gt[t].x) + fabs(best->y - gt[t].y);
+      const PoseEstimate &estimate = pf.poseEstimate();
+      estimate_error += fabs(estimate.x - gt[t].x) +
+                        fabs(estimate.y - gt[t].y);
+
+      std::chrono::steady_clock::time_point const resample_start =
+          std::chrono::steady_clock::now();
+      pf.resample();
+      seconds += std::chrono::duration<double>(
+          updated - start + std::chrono::steady_clock::now() -
+          resample_start).count();
+      ++num_frames;
+    }
+  }
+
+  printf("| %-6s | %-23.3f | %-27.3f | %-19.2f |\n",
+         sizeof(pf_real) == sizeof(float) ? "float" : "double",
+         best_error / num_frames, estimate_error / num_frames,
+         1e3 * seconds / num_frames);
+  return 0;
+}
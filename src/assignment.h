@@ -0,0 +1,120 @@
+/**
+ * assignment.h
+ * Hungarian algorithm for the rectangular linear assignment problem, used
+ * by the global nearest neighbor data association.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef ASSIGNMENT_H_
+#define ASSIGNMENT_H_
+
+#include <limits>
+#include <vector>
+
+/**
+ * Solver of the linear assignment problem with rows <= cols, in
+ *   O(rows^2 * cols). The cost matrix and all the working buffers are kept
+ *   between calls, so solving the (small) problems of every particle does
+ *   not allocate once the buffers have grown to the largest size.
+ */
+class AssignmentSolver {
+ public:
+  AssignmentSolver() : num_rows(0), num_cols(0) {}
+
+  /**
+   * resize Prepares the cost matrix for a rows x cols problem.
+   */
+  void resize(int rows, int cols) {
+    num_rows = rows;
+    num_cols = cols;
+    costs.resize(static_cast<size_t>(rows) * cols);
+  }
+
+  /**
+   * cost Returns the cost of assigning row i to column j (0-based).
+   */
+  double &cost(int i, int j) {
+    return costs[static_cast<size_t>(i) * num_cols + j];
+  }
+
+  /**
+   * solve Finds the assignment of every row to a distinct column with the
+   *   minimum total cost.
+   * @param row_to_col Vector filled with the column assigned to each row
+   */
+  void solve(std::vector<int> &row_to_col) {
+    int const n = num_rows;
+    int const m = num_cols;
+    double const inf = std::numeric_limits<double>::infinity();
+
+    // Potentials, matching and augmenting path (1-based, 0 is a sentinel)
+    u.assign(n + 1, 0.0);
+    v.assign(m + 1, 0.0);
+    match.assign(m + 1, 0);
+    way.assign(m + 1, 0);
+
+    for (int i = 1; i <= n; ++i) {
+      match[0] = i;
+      int j0 = 0;
+      min_slack.assign(m + 1, inf);
+      used.assign(m + 1, false);
+
+      // Grow the alternating tree until a free column is reached
+      do {
+        used[j0] = true;
+        int const i0 = match[j0];
+        double delta = inf;
+        int j1 = 0;
+        for (int j = 1; j <= m; ++j) {
+          if (used[j]) {
+            continue;
+          }
+          double const reduced = cost(i0 - 1, j - 1) - u[i0] - v[j];
+          if (reduced < min_slack[j]) {
+            min_slack[j] = reduced;
+            way[j] = j0;
+          }
+          if (min_slack[j] < delta) {
+            delta = min_slack[j];
+            j1 = j;
+          }
+        }
+        for (int j = 0; j <= m; ++j) {
+          if (used[j]) {
+            u[match[j]] += delta;
+            v[j] -= delta;
+          } else {
+            min_slack[j] -= delta;
+          }
+        }
+        j0 = j1;
+      } while (match[j0] != 0);
+
+      // Augment along the path
+      do {
+        int const j1 = way[j0];
+        match[j0] = match[j1];
+        j0 = j1;
+      } while (j0 != 0);
+    }
+
+    row_to_col.assign(n, -1);
+    for (int j = 1; j <= m; ++j) {
+      if (match[j] != 0) {
+        row_to_col[match[j] - 1] = j - 1;
+      }
+    }
+  }
+
+ private:
+  int num_rows;
+  int num_cols;
+  std::vector<double> costs;
+
+  std::vector<double> u, v, min_slack;
+  std::vector<int> match, way;
+  std::vector<bool> used;
+};
+
+#endif  // ASSIGNMENT_H_
@@ -0,0 +1,103 @@
+/**
+ * association_arena.h
+ * Per-frame bump arena for the debugging associations of the particles.
+ *
+ * The associations of all the particles of a frame are appended to one
+ * buffer, which is reset (not freed) at the next frame. A particle only
+ * holds the span of its records, so copying particles in resample does not
+ * copy (or allocate) any association. Every reset starts a new epoch, and
+ * a span is only valid in the epoch it was made in.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef ASSOCIATION_ARENA_H_
+#define ASSOCIATION_ARENA_H_
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * One association: landmark id and observation in map coordinates.
+ */
+struct association_s {
+  int64_t id;      // External id of the landmark
+  double sense_x;  // Observation x in map coordinates [m]
+  double sense_y;  // Observation y in map coordinates [m]
+};
+
+/**
+ * Records of a particle in the arena.
+ */
+struct AssociationSpan {
+  AssociationSpan() : offset(0), count(0), epoch(0) {}
+  uint32_t offset;
+  uint32_t count;
+  uint32_t epoch;  // Epoch of the arena the records were appended in
+};
+
+class AssociationArena {
+ public:
+  AssociationArena() : used(0), epoch(1) {}
+
+  /**
+   * reset Discards all the records, keeping the memory, and starts a new
+   *   epoch (0, the epoch of the empty span, is skipped).
+   */
+  void reset() {
+    used = 0;
+    if (++epoch == 0) {
+      epoch = 1;
+    }
+  }
+
+  /**
+   * mark, spanFrom Delimit the records appended by push in between.
+   */
+  uint32_t mark() const {
+    return used;
+  }
+  AssociationSpan spanFrom(uint32_t start) const {
+    AssociationSpan span;
+    span.offset = start;
+    span.count = used - start;
+    span.epoch = epoch;
+    return span;
+  }
+
+  /**
+   * rollback Discards the records appended since a mark.
+   */
+  void rollback(uint32_t start) {
+    used = start;
+  }
+
+  void push(int64_t id, double sense_x, double sense_y) {
+    if (used == records.size()) {
+      records.resize(records.empty() ? 1024 : 2 * records.size());
+    }
+    association_s &record = records[used++];
+    record.id = id;
+    record.sense_x = sense_x;
+    record.sense_y = sense_y;
+  }
+
+  /**
+   * recordsOf Returns the first record of a span, or NULL if the span is
+   *   empty or was made before the last reset (by another frame).
+   */
+  const association_s *recordsOf(const AssociationSpan &span) const {
+    if (span.count == 0 || span.epoch != epoch ||
+        span.offset + span.count > used) {
+      return NULL;
+    }
+    return &records[span.offset];
+  }
+
+ private:
+  std::vector<association_s> records;
+  uint32_t used;
+  uint32_t epoch;
+};
+
+#endif  // ASSOCIATION_ARENA_H_
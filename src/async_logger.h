@@ -0,0 +1,232 @@
+/**
+ * async_logger.h
+ * Asynchronous structured logger for the message handling hot path.
+ *
+ * Records are formatted by the calling thread into a lock-free per-thread
+ * ring buffer, and written out (key=value lines on stdout) by a background
+ * flusher thread, so logging never blocks on the output stream.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef ASYNC_LOGGER_H_
+#define ASYNC_LOGGER_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum LogLevel {
+  LOG_DEBUG = 0,
+  LOG_INFO,
+  LOG_WARN,
+  LOG_ERROR
+};
+
+inline const char *log_level_name(int level) {
+  static const char *const names[] = {"debug", "info", "warn", "error"};
+  return names[level];
+}
+
+/**
+ * Asynchronous logger. Use the process wide instance returned by
+ *   async_logger(): the per-thread rings are bound to it.
+ */
+class AsyncLogger {
+ public:
+  static const int kRingCapacity = 1024;  // Records per thread (power of 2)
+  static const int kMaxMessage = 224;     // Max length of a formatted record
+  static const int kFlushPeriodMs = 20;   // Period of the background flusher
+
+  AsyncLogger() : min_level(LOG_INFO), rate_limit(1000), running(true),
+                  reported_dropped(0) {
+    flusher = std::thread(&AsyncLogger::flushLoop, this);
+  }
+
+  ~AsyncLogger() {
+    running.store(false);
+    flusher.join();
+    flush();
+  }
+
+  /**
+   * setLevel Sets the minimum level of the records to keep.
+   */
+  void setLevel(LogLevel level) {
+    min_level.store(level, std::memory_order_relaxed);
+  }
+
+  /**
+   * setRateLimit Sets the maximum number of records per second and per
+   *   thread; records above the limit are dropped (and counted).
+   */
+  void setRateLimit(int records_per_second) {
+    rate_limit.store(records_per_second, std::memory_order_relaxed);
+  }
+
+  bool enabled(LogLevel level) const {
+    return level >= min_level.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * log Appends a record to the ring of the calling thread.
+   * @param level Level of the record
+   * @param event Name of the event
+   * @param format printf-like format of the record fields, as key=value
+   */
+  __attribute__((format(printf, 4, 5)))
+  void log(LogLevel level, const char *event, const char *format, ...) {
+    if (!enabled(level)) {
+      return;
+    }
+
+    Ring &ring = threadRing();
+
+    // Token bucket rate limiting, refilled with the elapsed time
+    uint64_t const now = nowMicros();
+    double const rate = rate_limit.load(std::memory_order_relaxed);
+    ring.tokens += (now - ring.last_refill) * 1e-6 * rate;
+    ring.last_refill = now;
+    if (ring.tokens > rate) {
+      ring.tokens = rate;
+    }
+    if (ring.tokens < 1.0) {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    ring.tokens -= 1.0;
+
+    // Drop the record if the flusher is lagging behind
+    uint64_t const tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) >= kRingCapacity) {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    Record &record = ring.records[tail & (kRingCapacity - 1)];
+    record.timestamp = now;
+    record.level = level;
+    record.event = event;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(record.message, kMaxMessage, format, args);
+    va_end(args);
+
+    ring.tail.store(tail + 1, std::memory_order_release);
+  }
+
+  /**
+   * flush Writes out all the pending records.
+   */
+  void flush() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    std::string out;
+    char prefix[96];
+    uint64_t dropped = 0;
+
+    for (size_t r = 0; r < rings.size(); ++r) {
+      Ring &ring = *rings[r];
+      uint64_t head = ring.head.load(std::memory_order_relaxed);
+      uint64_t const tail = ring.tail.load(std::memory_order_acquire);
+      for (; head != tail; ++head) {
+        const Record &record = ring.records[head & (kRingCapacity - 1)];
+        snprintf(prefix, sizeof(prefix), "ts=%llu.%06llu level=%s event=",
+                 static_cast<unsigned long long>(record.timestamp / 1000000),
+                 static_cast<unsigned long long>(record.timestamp % 1000000),
+                 log_level_name(record.level));
+        out += prefix;
+        out += record.event;
+        out += ' ';
+        out += record.message;
+        out += '\n';
+      }
+      ring.head.store(head, std::memory_order_release);
+      dropped += ring.dropped.load(std::memory_order_relaxed);
+    }
+
+    if (dropped != reported_dropped) {
+      snprintf(prefix, sizeof(prefix), "level=warn event=log_dropped total=%llu\n",
+               static_cast<unsigned long long>(dropped));
+      out += prefix;
+      reported_dropped = dropped;
+    }
+
+    if (!out.empty()) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      fflush(stdout);
+    }
+  }
+
+ private:
+  struct Record {
+    uint64_t timestamp;   // Wall clock time [us]
+    int level;
+    const char *event;    // Must point to a string literal
+    char message[kMaxMessage];
+  };
+
+  // Single producer (owning thread), single consumer (flusher) ring
+  struct Ring {
+    Ring() : head(0), tail(0), dropped(0), tokens(0.0),
+             last_refill(nowMicros()) {}
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    double tokens;
+    uint64_t last_refill;
+    Record records[kRingCapacity];
+  };
+
+  static uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  Ring &threadRing() {
+    // The registration (once per thread) is the only locked operation
+    thread_local Ring *ring = nullptr;
+    if (ring == nullptr) {
+      ring = new Ring();
+      ring->tokens = rate_limit.load(std::memory_order_relaxed);
+      std::lock_guard<std::mutex> lock(rings_mutex);
+      rings.push_back(ring);
+    }
+    return *ring;
+  }
+
+  void flushLoop() {
+    while (running.load()) {
+      // Copied: binding the constant to the duration's reference parameter
+      // would need an out-of-class definition (unoptimized builds)
+      int const period_ms = kFlushPeriodMs;
+      std::this_thread::sleep_for(std::chrono::milliseconds(period_ms));
+      flush();
+    }
+  }
+
+  std::atomic<int> min_level;
+  std::atomic<int> rate_limit;
+  std::atomic<bool> running;
+  uint64_t reported_dropped;
+
+  // Rings are never released: threads may log until the process exits
+  std::mutex rings_mutex;
+  std::vector<Ring *> rings;
+  std::thread flusher;
+};
+
+/**
+ * Returns the process wide asynchronous logger.
+ */
+inline AsyncLogger &async_logger() {
+  static AsyncLogger logger;
+  return logger;
+}
+
+#endif  // ASYNC_LOGGER_H_
@@ -0,0 +1,421 @@
+/**
+ * bench.cpp
+ * Micro-benchmarks of the stages of the particle filter (Google Benchmark),
+ * swept over the number of particles, of landmarks and of observations on
+ * synthetic maps (synthetic_world.h).
+ *
+ * Usage: pf_bench [--benchmark_filter=<regex>] [--benchmark_format=json]
+ *   The JSON output of two commits can be compared with the compare.py tool
+ *   shipped with Google Benchmark.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "filter_setup.h"
+#include "helper_functions.h"
+#include "particle_filter.h"
+#include "static_particle_filter.h"
+#include "synthetic_world.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+/**
+ * Synthetic map sized so that, on average, the requested number of landmarks
+ *   is in sensor range of the vehicle, which is at the center of the map.
+ */
+struct BenchWorld {
+  Map map;
+  double x;
+  double y;
+  double theta;
+  vector<LandmarkObs> observations;
+
+  BenchWorld(int num_landmarks, int num_observations, bool index) {
+    std::default_random_engine gen(42);
+    double const side = sqrt(num_landmarks * M_PI * kSensorRange *
+                             kSensorRange / num_observations);
+    make_synthetic_map(num_landmarks, side, side, gen, map);
+    x = side / 2;
+    y = side / 2;
+    theta = 0.3;
+    observations = make_synthetic_observations(map, x, y, theta, kSensorRange,
+                                               kSigmaLandmark, gen);
+    if (index) {
+      map.buildIndex(kSensorRange / 2);
+    }
+  }
+};
+
+void BM_Init(benchmark::State &state) {
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  for (auto _ : state) {
+    pf.init(10.0, 20.0, 0.3, kSigmaPos);
+    benchmark::DoNotOptimize(pf.particles.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Init)->Arg(100)->Arg(1000)->Arg(10000);
+
+void BM_Prediction(benchmark::State &state) {
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.init(10.0, 20.0, 0.3, kSigmaPos);
+  // Straight line (0) or turning (1) kernel
+  double const yaw_rate = state.range(1) ? 0.15 : 0.0;
+  for (auto _ : state) {
+    pf.prediction(0.1, kSigmaPos, 5.0, yaw_rate);
+    benchmark::DoNotOptimize(pf.particles.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Prediction)->ArgsProduct({{100, 1000, 10000}, {0, 1}});
+
+void BM_DataAssociation(benchmark::State &state) {
+  std::default_random_engine gen(42);
+  std::uniform_real_distribution<double> coord(0.0, 2 * kSensorRange);
+  vector<LandmarkObs> predicted(state.range(0));
+  for (size_t k = 0; k < predicted.size(); ++k) {
+    predicted[k].id = static_cast<int>(k);
+    predicted[k].x = coord(gen);
+    predicted[k].y = coord(gen);
+  }
+  vector<LandmarkObs> observations(state.range(1));
+  for (size_t j = 0; j < observations.size(); ++j) {
+    observations[j].id = 0;
+    observations[j].x = coord(gen);
+    observations[j].y = coord(gen);
+  }
+
+  ParticleFilter pf;
+  for (auto _ : state) {
+    pf.dataAssociation(predicted, observations);
+    benchmark::DoNotOptimize(observations.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_DataAssociation)->ArgsProduct({{10, 40, 160}, {10, 40}});
+
+/**
+ * updateWeights with the configuration of the server (grid index, shared
+ *   candidates, gating, likelihood floor), all set up by setup_filter, which
+ *   indexes the map.
+ */
+void BM_UpdateWeights(benchmark::State &state) {
+  BenchWorld world(state.range(1), state.range(2), false);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  setup_filter(pf, world.map, kSensorRange);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  for (auto _ : state) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                     world.map);
+  }
+  state.counters["observations"] = world.observations.size();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateWeights)
+    ->ArgsProduct({{100, 1000, 10000}, {1000, 10000, 100000}, {10, 40}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * updateWeights with the default configuration: linear scan of the map, the
+ *   O(particles x landmarks) baseline.
+ */
+void BM_UpdateWeightsLinear(benchmark::State &state) {
+  BenchWorld world(state.range(1), state.range(2), false);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  for (auto _ : state) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                     world.map);
+  }
+  state.counters["observations"] = world.observations.size();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateWeightsLinear)
+    ->ArgsProduct({{100, 1000}, {1000, 10000}, {10, 40}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * resample with and without the spatial (Morton) ordering of the resampled
+ *   particles.
+ */
+void BM_Resample(benchmark::State &state) {
+  BenchWorld world(10000, 20, true);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.setSpatialOrdering(state.range(1) != 0);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                   world.map);
+  for (auto _ : state) {
+    pf.resample();
+    benchmark::DoNotOptimize(pf.particles.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Resample)->ArgsProduct({{100, 1000, 10000}, {0, 1}});
+
+/**
+ * resample with the regularization kernels (none, gaussian, Epanechnikov).
+ */
+void BM_ResampleRegularized(benchmark::State &state) {
+  BenchWorld world(10000, 20, true);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.setRegularization(static_cast<RegularizationKernel>(state.range(1)),
+                       1.0);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                   world.map);
+  for (auto _ : state) {
+    pf.resample();
+    benchmark::DoNotOptimize(pf.particles.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ResampleRegularized)
+    ->ArgsProduct({{1000, 10000},
+                   {NO_REGULARIZATION, GAUSSIAN_KERNEL, EPANECHNIKOV_KERNEL}});
+
+/**
+ * Full update and resample cycle, where the spatial ordering pays back in
+ *   the locality of the next updateWeights.
+ */
+void BM_ResampleThenUpdate(benchmark::State &state) {
+  BenchWorld world(10000, 20, true);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.setSpatialOrdering(state.range(1) != 0);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  for (auto _ : state) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                     world.map);
+    pf.resample();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ResampleThenUpdate)
+    ->ArgsProduct({{1000, 10000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * updateWeights of freshly resampled particles (copies of a few ancestors),
+ *   with (1) and without (0) the deduplicated evaluation of bit-identical
+ *   particles.
+ */
+void BM_UpdateWeightsDeduplicated(benchmark::State &state) {
+  BenchWorld world(10000, 20, false);  // Indexed by setup_filter
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  setup_filter(pf, world.map, kSensorRange);
+  pf.setDeduplication(state.range(1) != 0, 0.0, 0.0);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                   world.map);
+  pf.resample();
+  for (auto _ : state) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                     world.map);
+  }
+  state.counters["reuse"] = static_cast<double>(pf.likelihoodReuses()) /
+      (pf.likelihoodReuses() + pf.likelihoodEvaluations());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateWeightsDeduplicated)
+    ->ArgsProduct({{1000, 10000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Update and resample cycle of a kidnapped filter (the observations come
+ *   from the other side of the map), with uniform (1) or map guided (2)
+ *   recovery poses: nearly every particle is replaced at every frame.
+ */
+void BM_KidnapRecovery(benchmark::State &state) {
+  BenchWorld world(10000, 20, false);  // Indexed by setup_filter
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  setup_filter(pf, world.map, kSensorRange);
+  pf.setRecovery(static_cast<RecoveryMode>(state.range(1)), 0.001, 0.1);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                   world.map);
+  pf.resample();
+
+  std::default_random_engine gen(7);
+  vector<LandmarkObs> elsewhere = make_synthetic_observations(
+      world.map, world.x / 4, world.y / 4, -world.theta, kSensorRange,
+      kSigmaLandmark, gen);
+  for (auto _ : state) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, elsewhere, world.map);
+    pf.resample();
+  }
+  state.counters["injection"] = pf.injectionProbability();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_KidnapRecovery)
+    ->ArgsProduct({{1000, 10000}, {UNIFORM_RECOVERY, MAP_GUIDED_RECOVERY}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Global initialization vote of a single observation set, for growing maps
+ *   with 10 or 20 landmarks in sensor range.
+ */
+void BM_PoseVote(benchmark::State &state) {
+  BenchWorld world(state.range(0), state.range(1), true);
+  PoseVoter voter;
+  setup_pose_voter(voter, world.map, kSensorRange, kSigmaLandmark);
+  vector<PoseCandidate> candidates;
+  for (auto _ : state) {
+    voter.vote(world.observations, 8, candidates);
+    benchmark::DoNotOptimize(candidates.data());
+  }
+  state.counters["pairs"] = voter.pairCount();
+  state.counters["error"] = candidates.empty() ? -1.0 :
+      hypot(candidates[0].x - world.x, candidates[0].y - world.y);
+}
+BENCHMARK(BM_PoseVote)
+    ->ArgsProduct({{1000, 10000, 100000}, {10, 20}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Whole frame with sampling importance resampling (0) or with the auxiliary
+ *   particle filter (1), which scores the particles twice per frame. The
+ *   vehicle stands still (zero velocity and yaw rate, the prediction only
+ *   adds the motion noise), so that the observations stay valid.
+ */
+void BM_Frame(benchmark::State &state) {
+  BenchWorld world(10000, 20, false);  // Indexed by setup_filter
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  setup_filter(pf, world.map, kSensorRange);
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                   world.map);
+  bool const auxiliary = state.range(1) != 0;
+  for (auto _ : state) {
+    if (auxiliary) {
+      pf.auxiliaryUpdate(0.1, kSigmaPos, 0.0, 0.0, kSensorRange,
+                         kSigmaLandmark, world.observations, world.map);
+    } else {
+      pf.prediction(0.1, kSigmaPos, 0.0, 0.0);
+      pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                       world.map);
+      pf.resample();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Frame)
+    ->ArgsProduct({{100, 1000, 5000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Whole frame of the default ParticleFilter pipeline (no setup_filter
+ *   options), and of the same pipeline compiled by StaticParticleFilter.
+ *   Both compute the same particles, see static_particle_filter_test.cpp.
+ */
+void BM_DefaultFrame(benchmark::State &state) {
+  BenchWorld world(10000, 20, true);
+  ParticleFilter pf;
+  pf.setNumParticles(state.range(0));
+  pf.init(world.x, world.y, world.theta, kSigmaPos);
+  for (auto _ : state) {
+    pf.prediction(0.1, kSigmaPos, 0.0, 0.0);
+    pf.updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                     world.map);
+    pf.resample();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DefaultFrame)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+template <size_t N>
+void BM_StaticFrame(benchmark::State &state) {
+  BenchWorld world(10000, 20, true);
+  typedef StaticParticleFilter<BicycleMotion, GaussianMeasurement,
+                               WheelResampler, N> Filter;
+  std::unique_ptr<Filter> pf(new Filter());
+  pf->init(world.x, world.y, world.theta, kSigmaPos);
+  for (auto _ : state) {
+    pf->prediction(0.1, kSigmaPos, 0.0, 0.0);
+    pf->updateWeights(kSensorRange, kSigmaLandmark, world.observations,
+                      world.map);
+    pf->resample();
+  }
+  state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK_TEMPLATE(BM_StaticFrame, 100)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_StaticFrame, 1000)->Unit(benchmark::kMicrosecond);
+
+void BM_DebugStrings(benchmark::State &state) {
+  Particle particle;
+  vector<int64_t> associations(state.range(0));
+  vector<double> sense_x(state.range(0));
+  vector<double> sense_y(state.range(0));
+  for (int j = 0; j < state.range(0); ++j) {
+    associations[j] = j + 1;
+    sense_x[j] = 100.0 + j * 0.37;
+    sense_y[j] = -50.0 + j * 0.71;
+  }
+  ParticleFilter pf;
+  pf.SetAssociations(particle, associations, sense_x, sense_y);
+  for (auto _ : state) {
+    string ids = pf.getAssociations(particle);
+    string xs = pf.getSenseCoord(particle, "X");
+    string ys = pf.getSenseCoord(particle, "Y");
+    benchmark::DoNotOptimize(ids.data());
+    benchmark::DoNotOptimize(xs.data());
+    benchmark::DoNotOptimize(ys.data());
+  }
+}
+BENCHMARK(BM_DebugStrings)->Arg(10)->Arg(40);
+
+void BM_ReadMapData(benchmark::State &state) {
+  std::default_random_engine gen(42);
+  Map synthetic;
+  make_synthetic_map(state.range(0), 1000.0, 1000.0, gen, synthetic);
+  string const filename = "pf_bench_map.txt";
+  {
+    std::ofstream out(filename.c_str());
+    for (size_t k = 0; k < synthetic.landmark_list.size(); ++k) {
+      out << synthetic.landmark_list[k].x_f << "\t"
+          << synthetic.landmark_list[k].y_f << "\t"
+          << synthetic.landmark_list[k].id_i << "\n";
+    }
+  }
+  for (auto _ : state) {
+    Map map;
+    if (!read_map_data(filename, map)) {
+      state.SkipWithError("could not read the map file");
+      break;
+    }
+    benchmark::DoNotOptimize(map.landmark_list.data());
+  }
+  remove(filename.c_str());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReadMapData)
+    ->Arg(42)->Arg(1000)->Arg(100000)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+/**
+ * filter_setup.h
+ * Configuration of the filter and of the map shared by the websocket
+ * server (main.cpp) and the offline tools, so that they all run the same
+ * pipeline.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef FILTER_SETUP_H_
+#define FILTER_SETUP_H_
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "map.h"
+#include "particle_filter.h"
+#include "pose_voting.h"
+
+/**
+ * setup_filter Configures the filter and indexes the map.
+ * @param pf Particle filter to configure
+ * @param map Map to index
+ * @param sensor_range Range [m] of sensor
+ */
+inline void setup_filter(ParticleFilter &pf, Map &map, double sensor_range) {
+  // Grid index used to find the landmarks in sensor range of the particles
+  map.buildIndex(sensor_range / 2);
+
+  // The particles keep the resample order (the Morton ordering of
+  // setSpatialOrdering costs more in resample than it saves in
+  // updateWeights, see BM_ResampleThenUpdate)
+  pf.setSharedCandidates(5.0);
+  // Gate associations at the 99.9% of the chi-square with 2 DOF
+  pf.setAssociationGate(13.82, 1e-3);
+  // Drop particles more than 50 nats below the best one of the frame
+  pf.setLikelihoodFloor(50.0);
+}
+
+/**
+ * setup_deduplication Enables the deduplicated likelihood evaluation, with
+ *   a yaw quantization step matching the position step at half the sensor
+ *   range.
+ * @param pf Particle filter to configure
+ * @param epsilon Quantization step [m], 0 for bit-identical particles only
+ * @param sensor_range Range [m] of sensor
+ */
+inline void setup_deduplication(ParticleFilter &pf, double epsilon,
+                                double sensor_range) {
+  pf.setDeduplication(true, epsilon, epsilon / (0.5 * sensor_range));
+}
+
+/**
+ * setup_pose_voter Indexes the landmark pairs of the map for the global
+ *   initialization, with a distance tolerance of 2 standard deviations
+ *   of the separation of two observations.
+ * @param voter Pose voter to build
+ * @param map Map (indexed by setup_filter)
+ * @param sensor_range Range [m] of sensor
+ * @param sigma_landmark[] Landmark measurement uncertainty [x [m], y [m]]
+ * @output False if the sensor range or the uncertainty is not positive
+ */
+inline bool setup_pose_voter(PoseVoter &voter, const Map &map,
+                             double sensor_range,
+                             const double sigma_landmark[]) {
+  double const sigma = std::max(sigma_landmark[0], sigma_landmark[1]);
+  return voter.build(map, 2.0 * sensor_range, 2.0 * sqrt(2.0) * sigma);
+}
+
+/**
+ * init_filter Initializes the filter from the candidate poses voted by the
+ *   observations of the first frame, or from the GPS prior if global
+ *   initialization is disabled or no pose gets the votes of two
+ *   observation pairs.
+ * @param pf Particle filter to initialize
+ * @param voter Pose voter (see setup_pose_voter), unused if max_candidates
+ *   is 0
+ * @param max_candidates Maximum number of candidate poses seeded, 0 to
+ *   initialize from the GPS prior
+ * @param observations Observations of the first frame
+ * @param (x,y,theta) GPS prior
+ * @param sigma_pos[] GPS measurement uncertainty [x [m], y [m], theta [rad]]
+ * @param candidates Candidate poses seeded (cleared)
+ */
+inline void init_filter(ParticleFilter &pf, PoseVoter &voter,
+                        int max_candidates,
+                        const std::vector<LandmarkObs> &observations,
+                        double x, double y, double theta, double sigma_pos[],
+                        std::vector<PoseCandidate> &candidates) {
+  candidates.clear();
+  if (max_candidates > 0 &&
+      voter.vote(observations, max_candidates, candidates) > 0) {
+    double spread[3];
+    voter.candidateSpread(spread);
+    pf.initFromCandidates(candidates, spread);
+    return;
+  }
+  pf.init(x, y, theta, sigma_pos);
+}
+
+#endif  // FILTER_SETUP_H_
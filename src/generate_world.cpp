@@ -0,0 +1,209 @@
+/**
+ * generate_world.cpp
+ * Generator of synthetic worlds for load testing: a map with a configurable
+ * landmark density over a large area, and a drive through it.
+ *
+ * Writes, in the formats of the readers of helper_functions.h:
+ *   <out>/map_data.txt                   x y id          (read_map_data)
+ *   <out>/gt_data.txt                    x y theta       (read_gt_data)
+ *   <out>/control_data.txt               velocity yawrate (read_control_data)
+ *   <out>/observation/observations_NNNNNN.txt
+ *                                        x y, vehicle coordinates, one file
+ *                                        per time step   (read_landmark_data)
+ *
+ * Usage: pf_generate <out dir> [--width m] [--height m] [--density n/km^2]
+ *          [--steps n] [--velocity m/s] [--sensor-range m] [--seed n]
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "helper_functions.h"
+#include "synthetic_world.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * make_directory Creates a directory, if it does not exist yet.
+ * @output True if the directory exists
+ */
+static bool make_directory(const string &path) {
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+/**
+ * parse_integer Parses a whole command line value as an integer in
+ *   [min_value, max_value].
+ */
+static bool parse_integer(const char *text, long long min_value,
+                          long long max_value, long long &value) {
+  char *end;
+  errno = 0;
+  value = strtoll(text, &end, 10);
+  return end != text && *end == '\0' && errno == 0 && value >= min_value &&
+         value <= max_value;
+}
+
+/**
+ * parse_number Parses a whole command line value as a finite number above
+ *   min_value.
+ */
+static bool parse_number(const char *text, double min_value, double &value) {
+  char *end;
+  errno = 0;
+  value = strtod(text, &end);
+  return end != text && *end == '\0' && errno == 0 && isfinite(value) &&
+         value > min_value;
+}
+
+static void print_usage(const char *program) {
+  std::cerr << "Usage: " << program << " <out dir> [--width m] [--height m]"
+            << " [--density n/km^2] [--steps n] [--velocity m/s]"
+            << " [--sensor-range m] [--seed n]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return -1;
+  }
+  string const out_dir = argv[1];
+
+  // Defaults: 5 km x 5 km, about 8 landmarks in sensor range, 5 minutes of
+  // driving at 10 m/s
+  double width = 5000.0;
+  double height = 5000.0;
+  double density = 1000.0;
+  int num_steps = 3000;
+  double velocity = 10.0;
+  double sensor_range = 50.0;
+  unsigned int seed = 42;
+  double const delta_t = 0.1;
+  double const sigma_landmark[2] = {0.3, 0.3};
+
+  // The generator does not run on an unknown option or an invalid value.
+  // The trajectory turns back 100 m from the border, hence the 300 m.
+  for (int i = 2; i < argc; i += 2) {
+    string const option = argv[i];
+    if (i + 1 == argc) {
+      std::cerr << "Error: Missing value of " << option << std::endl;
+      print_usage(argv[0]);
+      return -1;
+    }
+    const char *value = argv[i + 1];
+    long long integer = 0;
+    bool valid;
+    if (option == "--width") {
+      valid = parse_number(value, 0.0, width) && width >= 300.0;
+    } else if (option == "--height") {
+      valid = parse_number(value, 0.0, height) && height >= 300.0;
+    } else if (option == "--density") {
+      valid = parse_number(value, 0.0, density);
+    } else if (option == "--steps") {
+      valid = parse_integer(value, 1, INT_MAX, integer);
+      num_steps = integer;
+    } else if (option == "--velocity") {
+      valid = parse_number(value, 0.0, velocity);
+    } else if (option == "--sensor-range") {
+      valid = parse_number(value, 0.0, sensor_range);
+    } else if (option == "--seed") {
+      valid = parse_integer(value, 0, UINT_MAX, integer);
+      seed = integer;
+    } else {
+      std::cerr << "Error: Unknown option " << option << std::endl;
+      print_usage(argv[0]);
+      return -1;
+    }
+    if (!valid) {
+      std::cerr << "Error: Invalid value " << value << " of " << option
+                << std::endl;
+      print_usage(argv[0]);
+      return -1;
+    }
+  }
+  // The landmark count must fit in an int
+  if (density * width * height / 1e6 > INT_MAX) {
+    std::cerr << "Error: Too many landmarks" << std::endl;
+    return -1;
+  }
+
+  if (!make_directory(out_dir) || !make_directory(out_dir + "/observation")) {
+    std::cerr << "Error: Could not create " << out_dir << std::endl;
+    return -1;
+  }
+
+  std::default_random_engine gen(seed);
+
+  // Map
+  int const num_landmarks = static_cast<int>(density * width * height / 1e6);
+  Map map;
+  make_synthetic_map(num_landmarks, width, height, gen, map);
+  FILE *file = fopen((out_dir + "/map_data.txt").c_str(), "w");
+  if (file == NULL) {
+    std::cerr << "Error: Could not write the map" << std::endl;
+    return -1;
+  }
+  for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+    fprintf(file, "%.4f\t%.4f\t%lld\n", map.landmark_list[k].x_f,
+            map.landmark_list[k].y_f,
+            static_cast<long long>(map.landmark_list[k].id_i));
+  }
+  fclose(file);
+  // Grid index to find the landmarks in sensor range
+  map.buildIndex(sensor_range / 2);
+
+  // Trajectory and controls
+  vector<ground_truth> gt;
+  vector<control_s> controls;
+  make_synthetic_trajectory(width, height, num_steps, delta_t, velocity, gen,
+                            gt, controls);
+  FILE *gt_file = fopen((out_dir + "/gt_data.txt").c_str(), "w");
+  FILE *control_file = fopen((out_dir + "/control_data.txt").c_str(), "w");
+  if (gt_file == NULL || control_file == NULL) {
+    std::cerr << "Error: Could not write the trajectory" << std::endl;
+    return -1;
+  }
+  for (int t = 0; t < num_steps; ++t) {
+    fprintf(gt_file, "%.6f %.6f %.6f\n", gt[t].x, gt[t].y, gt[t].theta);
+    fprintf(control_file, "%.6f %.6f\n", controls[t].velocity,
+            controls[t].yawrate);
+  }
+  fclose(gt_file);
+  fclose(control_file);
+
+  // Noisy observations, one file per time step
+  size_t total_observations = 0;
+  for (int t = 0; t < num_steps; ++t) {
+    char name[64];
+    snprintf(name, sizeof(name), "/observation/observations_%06d.txt", t + 1);
+    FILE *obs_file = fopen((out_dir + name).c_str(), "w");
+    if (obs_file == NULL) {
+      std::cerr << "Error: Could not write " << out_dir + name << std::endl;
+      return -1;
+    }
+    vector<LandmarkObs> const observations = make_synthetic_observations(
+        map, gt[t].x, gt[t].y, gt[t].theta, sensor_range, sigma_landmark, gen);
+    for (size_t j = 0; j < observations.size(); ++j) {
+      fprintf(obs_file, "%.4f %.4f\n", static_cast<double>(observations[j].x),
+              static_cast<double>(observations[j].y));
+    }
+    fclose(obs_file);
+    total_observations += observations.size();
+  }
+
+  std::cout << "Generated " << num_landmarks << " landmarks over " << width
+            << " m x " << height << " m, " << num_steps << " steps, "
+            << static_cast<double>(total_observations) / num_steps
+            << " observations per step in " << out_dir << std::endl;
+  return 0;
+}
@@ -21,6 +21,14 @@
 const double M_PI = 3.14159265358979323846;
 #endif
 
+// Scalar type of the particle state, of the observations and of the filter
+// kernels: single precision if built with PF_SINGLE_PRECISION
+#ifdef PF_SINGLE_PRECISION
+typedef float pf_real;
+#else
+typedef double pf_real;
+#endif
+
 /**
  * Struct representing one position/control measurement.
  */
@@ -43,9 +51,9 @@ struct ground_truth {
  */
 struct LandmarkObs {
   
-  int id;     // Id of matching landmark in the map.
-  double x;   // Local (vehicle coords) x position of landmark observation [m]
-  double y;   // Local (vehicle coords) y position of landmark observation [m]
+  int id;     // Index of matching landmark in the map landmark list.
+  pf_real x;  // Local (vehicle coords) x position of landmark observation [m]
+  pf_real y;  // Local (vehicle coords) y position of landmark observation [m]
 };
 
 /**
@@ -58,6 +66,12 @@ inline double dist(double x1, double y1, double x2, double y2) {
   return sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
 }
 
+#ifdef PF_SINGLE_PRECISION
+inline float dist(float x1, float y1, float x2, float y2) {
+  return sqrtf((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+}
+#endif
+
 /**
  * Computes the error between ground truth and particle filter data.
  * @param (gt_x, gt_y, gt_theta) x, y and theta of ground truth
@@ -100,7 +114,7 @@ inline bool read_map_data(std::string filename, Map& map) {
 
     // Declare landmark values and ID
     float landmark_x_f, landmark_y_f;
-    int id_i;
+    int64_t id_i;
 
     // Read data from current line to values
     iss_map >> landmark_x_f;
@@ -118,6 +132,9 @@ inline bool read_map_data(std::string filename, Map& map) {
     // Add to landmark list of map
     map.landmark_list.push_back(single_landmark_temp);
   }
+
+  // Map the external ids to dense indices
+  map.buildIdLookup();
   return true;
 }
 
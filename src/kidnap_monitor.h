@@ -0,0 +1,87 @@
+/**
+ * kidnap_monitor.h
+ * Kidnap detection of Augmented MCL (Thrun, Burgard and Fox): short and long
+ * term averages of the likelihood of the particle set. While the short term
+ * average stays below the long term one, the observations are explained
+ * worse than usual, and a fraction of the particles should be replaced by
+ * recovery poses.
+ *
+ * The tracked value is the mean particle likelihood taken to the power of
+ * one over the number of observations (a per observation likelihood), so
+ * that it does not jump with the number of landmarks in view.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef KIDNAP_MONITOR_H_
+#define KIDNAP_MONITOR_H_
+
+#include <math.h>
+#include <algorithm>
+
+class KidnapMonitor {
+ public:
+  KidnapMonitor() : alpha_slow(0.0), alpha_fast(0.0) {
+    reset();
+  }
+
+  /**
+   * configure Sets the decay rates of the averages, and resets them.
+   * @param slow Decay rate of the long term average (e.g. 0.001)
+   * @param fast Decay rate of the short term average (e.g. 0.1)
+   */
+  void configure(double slow, double fast) {
+    alpha_slow = slow;
+    alpha_fast = fast;
+    reset();
+  }
+
+  void reset() {
+    w_slow = 0.0;
+    w_fast = 0.0;
+  }
+
+  /**
+   * update Adds the likelihood of a frame.
+   * @param mean_likelihood Mean of the unnormalized particle weights
+   * @param num_observations Number of observations of the frame
+   */
+  void update(double mean_likelihood, int num_observations) {
+    if (num_observations <= 0 || !(mean_likelihood >= 0.0) ||
+        isinf(mean_likelihood)) {
+      return;
+    }
+    double const w = pow(mean_likelihood, 1.0 / num_observations);
+    if (w_slow == 0.0) {
+      // Both averages start at the first frame
+      w_slow = w;
+      w_fast = w;
+      return;
+    }
+    w_slow += alpha_slow * (w - w_slow);
+    w_fast += alpha_fast * (w - w_fast);
+  }
+
+  /**
+   * injectionProbability Returns the probability of replacing a particle
+   *   by a recovery pose: max(0, 1 - w_fast / w_slow).
+   */
+  double injectionProbability() const {
+    return w_slow > 0.0 ? std::max(0.0, 1.0 - w_fast / w_slow) : 0.0;
+  }
+
+  double slowAverage() const {
+    return w_slow;
+  }
+  double fastAverage() const {
+    return w_fast;
+  }
+
+ private:
+  double alpha_slow;
+  double alpha_fast;
+  double w_slow;  // Long term average
+  double w_fast;  // Short term average
+};
+
+#endif  // KIDNAP_MONITOR_H_
@@ -0,0 +1,265 @@
+/**
+ * latency_stats.h
+ * Lock-free latency histograms for the per-stage instrumentation of the
+ * particle filter and of the websocket message handling.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef LATENCY_STATS_H_
+#define LATENCY_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Stages of the filter pipeline tracked by the instrumentation.
+ */
+enum LatencyStage {
+  STAGE_INIT = 0,
+  STAGE_PREDICTION,
+  STAGE_UPDATE_WEIGHTS,
+  STAGE_TRANSFORM,      // updateWeights, step 1
+  STAGE_RANGE_FILTER,   // updateWeights, step 2 (landmarks within range)
+  STAGE_ASSOCIATION,    // updateWeights, step 2 (dataAssociation)
+  STAGE_SCORING,        // updateWeights, step 3
+  STAGE_RESAMPLE,
+  STAGE_JSON_PARSE,
+  STAGE_REPLY,
+  NUM_LATENCY_STAGES
+};
+
+inline const char *latency_stage_name(int stage) {
+  static const char *const names[NUM_LATENCY_STAGES] = {
+    "init", "prediction", "updateWeights", "  transform", "  range_filter",
+    "  association", "  scoring", "resample", "json_parse", "reply"};
+  return names[stage];
+}
+
+/**
+ * Returns a monotonic timestamp [ns].
+ */
+inline uint64_t latency_now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * HDR-style histogram of latencies [ns].
+ * Values are stored in log-linear buckets: every power of two is split in
+ *   2^kSubBucketBits sub-buckets, which gives a relative precision better
+ *   than 2% over the whole 64 bit range. Recording is a single relaxed
+ *   atomic increment, so it can be done concurrently and without locks.
+ */
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 6;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kNumBuckets = kSubBuckets * (64 - kSubBucketBits + 1);
+
+  LatencyHistogram() {
+    reset();
+  }
+
+  void record(uint64_t value) {
+    counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    uint64_t current = max_value.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max_value.compare_exchange_weak(current, value,
+                                            std::memory_order_relaxed)) {
+    }
+  }
+
+  void reset() {
+    for (int i = 0; i < kNumBuckets; ++i) {
+      counts[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    max_value.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    return total.load(std::memory_order_relaxed);
+  }
+
+  uint64_t max() const {
+    return max_value.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * percentile Returns the (upper bound of the bucket of the) value below
+   *   which the given fraction of the recorded samples falls.
+   * @param p Fraction in [0, 1]
+   */
+  uint64_t percentile(double p) const {
+    uint64_t const n = count();
+    if (n == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * n + 0.5);
+    if (rank < 1) {
+      rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        uint64_t const upper = bucketUpperBound(i);
+        return upper < max() ? upper : max();
+      }
+    }
+    return max();
+  }
+
+ private:
+  static int bucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(kSubBuckets)) {
+      return static_cast<int>(value);
+    }
+    int const msb = 63 - __builtin_clzll(value);
+    int const shift = msb - kSubBucketBits;
+    return kSubBuckets * (shift + 1) +
+           static_cast<int>((value >> shift) - kSubBuckets);
+  }
+
+  static uint64_t bucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    int const shift = index / kSubBuckets - 1;
+    uint64_t const mantissa = kSubBuckets + index % kSubBuckets;
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+  std::atomic<uint64_t> counts[kNumBuckets];
+  std::atomic<uint64_t> total;
+  std::atomic<uint64_t> max_value;
+};
+
+/**
+ * Set of latency histograms, one for each stage.
+ */
+class LatencyStats {
+ public:
+  void record(int stage, uint64_t ns) {
+    histograms[stage].record(ns);
+  }
+
+  const LatencyHistogram &histogram(int stage) const {
+    return histograms[stage];
+  }
+
+  void reset() {
+    for (int i = 0; i < NUM_LATENCY_STAGES; ++i) {
+      histograms[i].reset();
+    }
+  }
+
+  /**
+   * report Returns a plain text table with count and p50/p99/p999/max [us]
+   *   of every stage.
+   */
+  std::string report() const {
+    std::string out;
+    char line[160];
+    snprintf(line, sizeof(line), "%-16s %10s %10s %10s %10s %10s\n",
+             "stage", "count", "p50[us]", "p99[us]", "p999[us]", "max[us]");
+    out += line;
+    for (int i = 0; i < NUM_LATENCY_STAGES; ++i) {
+      const LatencyHistogram &h = histograms[i];
+      snprintf(line, sizeof(line),
+               "%-16s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+               latency_stage_name(i),
+               static_cast<unsigned long long>(h.count()),
+               h.percentile(0.5) / 1e3, h.percentile(0.99) / 1e3,
+               h.percentile(0.999) / 1e3, h.max() / 1e3);
+      out += line;
+    }
+    return out;
+  }
+
+ private:
+  LatencyHistogram histograms[NUM_LATENCY_STAGES];
+};
+
+/**
+ * Returns the process wide latency statistics.
+ */
+inline LatencyStats &latency_stats() {
+  static LatencyStats stats;
+  return stats;
+}
+
+/**
+ * Records the time spent in the enclosing scope for the given stage.
+ */
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(int stage) : stage(stage), start(latency_now()) {}
+
+  ~ScopedLatency() {
+    latency_stats().record(stage, latency_now() - start);
+  }
+
+ private:
+  int stage;
+  uint64_t start;
+};
+
+/**
+ * Accumulates the time of interleaved sub-stages (laps) over a sample of
+ *   loop iterations, and records their extrapolation to the whole loop.
+ *   Used in updateWeights, where timing every particle would cost more
+ *   than the work being measured.
+ */
+class SampledStageLaps {
+ public:
+  SampledStageLaps() : active(false), samples(0), last(0) {
+    for (int i = 0; i < NUM_LATENCY_STAGES; ++i) {
+      laps[i] = 0;
+    }
+  }
+
+  // Starts timing the current iteration if it belongs to the sample
+  void begin(bool sampled) {
+    active = sampled;
+    if (active) {
+      ++samples;
+      last = latency_now();
+    }
+  }
+
+  // Closes the current lap, charging its time to the given stage
+  void lap(int stage) {
+    if (active) {
+      uint64_t const now = latency_now();
+      laps[stage] += now - last;
+      last = now;
+    }
+  }
+
+  // Records the laps scaled to the given number of iterations, those the
+  // sample was drawn from
+  void record(int iterations) const {
+    if (samples == 0) {
+      return;
+    }
+    for (int i = 0; i < NUM_LATENCY_STAGES; ++i) {
+      if (laps[i] > 0) {
+        latency_stats().record(i, laps[i] * iterations / samples);
+      }
+    }
+  }
+
+ private:
+  bool active;
+  int samples;
+  uint64_t last;
+  uint64_t laps[NUM_LATENCY_STAGES];
+};
+
+#endif  // LATENCY_STATS_H_
@@ -1,9 +1,23 @@
+#include <errno.h>
 #include <math.h>
 #include <uWS/uWS.h>
+#include <algorithm>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include "async_logger.h"
+#include "filter_setup.h"
 #include "json.hpp"
+#include "latency_stats.h"
 #include "particle_filter.h"
+#include "reply_writer.h"
+#include "session_log.h"
+#include "tiled_map.h"
+#include "versioned_map.h"
 
 // for convenience
 using nlohmann::json;
@@ -25,9 +39,184 @@ string hasData(string s) {
   return "";
 }
 
-int main() {
+// Set by SIGUSR1: the latency report is dumped while handling the next
+// message, outside of the signal handler.
+volatile std::sig_atomic_t latency_dump_requested = 0;
+
+void requestLatencyDump(int) {
+  latency_dump_requested = 1;
+}
+
+// Session recorder closed on SIGINT / SIGTERM, the only way the server
+// exits: frames are flushed as they are recorded, so the log is complete.
+SessionRecorder *session_recorder = NULL;
+
+void stopServer(int signal_number) {
+  if (session_recorder != NULL) {
+    session_recorder->closeFromSignal();
+  }
+  std::signal(signal_number, SIG_DFL);
+  std::raise(signal_number);
+}
+
+// Command line options, printed on an invalid command line.
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+    "  --record <file>     record the session for offline replay (pf_replay)\n"
+    "  --seed <n>          seed of the filter random engine\n"
+    "  --tiled-map <file>  stream the map from a tiled map (pf_tile_map)\n"
+    "  --map-budget <MB>   memory budget of the tile cache and active map\n"
+    "  --particles <n>     number of particles (1000 by default)\n"
+    "  --sampling <sir|auxiliary>  sampling importance resampling, or\n"
+    "                      auxiliary particle filter\n"
+    "  --regularization <none|gaussian|epanechnikov>  jitter of the\n"
+    "                      resampled particles\n"
+    "  --bandwidth <scale> scale of the optimal jitter bandwidth (1)\n"
+    "  --dedup <m>         score particles equal within this step once\n"
+    "                      (0: bit-identical particles only)\n"
+    "  --recovery <none|uniform|map>  kidnap recovery (not with --tiled-map)\n"
+    "  --global-init <n>   initialize from up to n poses voted by the first\n"
+    "                      observations instead of GPS (not with --tiled-map)\n"
+    "  --accept-map-updates  apply the landmark corrections posted to\n"
+    "                      /landmarks from the local host (not with\n"
+    "                      --tiled-map)"
+    << std::endl;
+}
+
+// Parses a whole command line value as an integer in [min_value, max_value].
+bool parseInteger(const char *text, long long min_value, long long max_value,
+                  long long &value) {
+  char *end;
+  errno = 0;
+  value = std::strtoll(text, &end, 10);
+  return end != text && *end == '\0' && errno == 0 && value >= min_value &&
+         value <= max_value;
+}
+
+// Parses a whole command line value as a number not below min_value.
+bool parseNumber(const char *text, double min_value, double &value) {
+  char *end;
+  value = std::strtod(text, &end);
+  return end != text && *end == '\0' && std::isfinite(value) &&
+         value >= min_value;
+}
+
+// Whether a peer address is on the local host (IPv4 or IPv6 loopback).
+bool isLoopback(const char *address) {
+  string const text = address != NULL ? address : "";
+  return text.compare(0, 4, "127.") == 0 || text == "::1" ||
+         text.compare(0, 11, "::ffff:127.") == 0;
+}
+
+// Bounding box and mean heading of the particle cloud, used to select the
+// tiles of a tiled map.
+void cloudBounds(const vector<Particle> &particles, double &min_x,
+                 double &min_y, double &max_x, double &max_y,
+                 double &heading) {
+  min_x = max_x = particles[0].x;
+  min_y = max_y = particles[0].y;
+  double sum_cos = 0.0;
+  double sum_sin = 0.0;
+  for (size_t i = 0; i < particles.size(); ++i) {
+    min_x = std::min<double>(min_x, particles[i].x);
+    max_x = std::max<double>(max_x, particles[i].x);
+    min_y = std::min<double>(min_y, particles[i].y);
+    max_y = std::max<double>(max_y, particles[i].y);
+    sum_cos += cos(particles[i].theta);
+    sum_sin += sin(particles[i].theta);
+  }
+  heading = atan2(sum_sin, sum_cos);
+}
+
+int main(int argc, char *argv[]) {
   uWS::Hub h;
 
+  // Command line options (see printUsage). The server does not start on an
+  // unknown option or an invalid value.
+  string record_file;
+  unsigned int seed = std::default_random_engine::default_seed;
+  string tiled_map_file;
+  size_t map_budget_mb = 256;
+  int num_particles = 1000;
+  bool auxiliary = false;
+  RegularizationKernel regularization = NO_REGULARIZATION;
+  double bandwidth = 1.0;
+  bool deduplicate = false;
+  double dedup_epsilon = 0.0;
+  RecoveryMode recovery = NO_RECOVERY;
+  double recovery_alpha[2] = {0.001, 0.1};
+  int global_init = 0;
+  bool accept_map_updates = false;
+  for (int i = 1; i < argc; ++i) {
+    string const option = argv[i];
+    if (option == "--accept-map-updates") {
+      accept_map_updates = true;
+      continue;
+    }
+    if (i + 1 == argc) {
+      std::cerr << "Error: Missing value of " << option << std::endl;
+      printUsage(argv[0]);
+      return -1;
+    }
+    string const value = argv[++i];
+    long long integer = 0;
+    bool valid = true;
+    if (option == "--record") {
+      record_file = value;
+      valid = !value.empty();
+    } else if (option == "--seed") {
+      valid = parseInteger(value.c_str(), 0, UINT_MAX, integer);
+      seed = integer;
+    } else if (option == "--tiled-map") {
+      tiled_map_file = value;
+      valid = !value.empty();
+    } else if (option == "--map-budget") {
+      valid = parseInteger(value.c_str(), 1, INT_MAX, integer);
+      map_budget_mb = integer;
+    } else if (option == "--particles") {
+      valid = parseInteger(value.c_str(), 1, INT_MAX, integer);
+      num_particles = integer;
+    } else if (option == "--sampling") {
+      valid = value == "sir" || value == "auxiliary";
+      auxiliary = value == "auxiliary";
+    } else if (option == "--regularization") {
+      valid = value == "none" || value == "gaussian" ||
+              value == "epanechnikov";
+      regularization = value == "gaussian" ? GAUSSIAN_KERNEL :
+                       value == "epanechnikov" ? EPANECHNIKOV_KERNEL :
+                       NO_REGULARIZATION;
+    } else if (option == "--bandwidth") {
+      valid = parseNumber(value.c_str(), 0.0, bandwidth) && bandwidth > 0.0;
+    } else if (option == "--dedup") {
+      deduplicate = true;
+      valid = parseNumber(value.c_str(), 0.0, dedup_epsilon);
+    } else if (option == "--recovery") {
+      valid = value == "none" || value == "uniform" || value == "map";
+      recovery = value == "uniform" ? UNIFORM_RECOVERY :
+                 value == "map" ? MAP_GUIDED_RECOVERY : NO_RECOVERY;
+    } else if (option == "--global-init") {
+      valid = parseInteger(value.c_str(), 0, INT_MAX, integer);
+      global_init = integer;
+    } else {
+      std::cerr << "Error: Unknown option " << option << std::endl;
+      printUsage(argv[0]);
+      return -1;
+    }
+    if (!valid) {
+      std::cerr << "Error: Invalid value " << value << " of " << option
+                << std::endl;
+      printUsage(argv[0]);
+      return -1;
+    }
+  }
+  if (!record_file.empty() && accept_map_updates) {
+    // The landmark corrections are not recorded, the session could not be
+    // replayed
+    std::cerr << "Error: --record cannot be combined with --accept-map-updates"
+              << std::endl;
+    return -1;
+  }
+
   // Set up parameters here
   double delta_t = 0.1;  // Time elapsed between measurements [sec]
   double sensor_range = 50;  // Sensor range [m]
@@ -36,47 +225,152 @@ int main() {
   double sigma_pos [3] = {0.3, 0.3, 0.01};
   // Landmark measurement uncertainty [x [m], y [m]]
   double sigma_landmark [2] = {0.3, 0.3};
+  // Report the weighted pose estimate of the particle set in the reply
+  bool send_pose_estimate = true;
+  // Report the associations of the best particle in the reply (debugging)
+  bool send_associations = true;
 
-  // Read map data
+  // Read map data, or open the tiled map
   Map map;
-  if (!read_map_data("../data/map_data.txt", map)) {
+  TiledMapStore map_store;
+  bool const tiled = !tiled_map_file.empty();
+  if (tiled) {
+    if (!map_store.open(tiled_map_file, map_budget_mb << 20)) {
+      std::cout << "Error: Could not open tiled map file" << std::endl;
+      return -1;
+    }
+    map_store.setIndexCell(sensor_range / 2);
+    if (recovery != NO_RECOVERY) {
+      // Recovery poses would spread the particles over every tile
+      std::cout << "Kidnap recovery is not supported with a tiled map"
+                << std::endl;
+      recovery = NO_RECOVERY;
+    }
+    if (global_init > 0) {
+      // The landmark pairs of the whole map would have to be indexed
+      std::cout << "Global initialization is not supported with a tiled map"
+                << std::endl;
+      global_init = 0;
+    }
+    if (accept_map_updates) {
+      std::cout << "Map updates are not supported with a tiled map"
+                << std::endl;
+      accept_map_updates = false;
+    }
+  } else if (!read_map_data("../data/map_data.txt", map)) {
     std::cout << "Error: Could not open map file" << std::endl;
     return -1;
   }
 
   // Create particle filter
   ParticleFilter pf;
+  setup_filter(pf, map, sensor_range);
+  pf.setPoseEstimation(send_pose_estimate);
+  pf.setNumParticles(num_particles);
+  pf.setRegularization(regularization, bandwidth);
+  if (deduplicate) {
+    setup_deduplication(pf, dedup_epsilon, sensor_range);
+  }
+  pf.setRecovery(recovery, recovery_alpha[0], recovery_alpha[1]);
+  pf.seed(seed);
+
+  // Index of the landmark pairs for the global initialization, built at
+  // INIT time from the map version of the frame
+  PoseVoter pose_voter;
 
-  h.onMessage([&pf,&map,&delta_t,&sensor_range,&sigma_pos,&sigma_landmark]
+  // Landmark corrections (POST /landmarks), if accepted, are applied to a
+  // versioned copy of the map, without pausing the filter
+  std::unique_ptr<VersionedMap> live_map;
+  int live_map_reader = -1;
+  if (accept_map_updates) {
+    live_map.reset(new VersionedMap(map, sensor_range / 2));
+    live_map_reader = live_map->addReader();
+  }
+
+  // Optional session recording
+  SessionRecorder recorder;
+  if (!record_file.empty()) {
+    session_header_s header = session_header_s();
+    header.seed = seed;
+    header.delta_t = delta_t;
+    header.sensor_range = sensor_range;
+    std::copy(sigma_pos, sigma_pos + 3, header.sigma_pos);
+    std::copy(sigma_landmark, sigma_landmark + 2, header.sigma_landmark);
+    header.num_particles = num_particles;
+    header.sampling = auxiliary ? session_header_s::AUXILIARY :
+                                  session_header_s::SIR;
+    header.regularization = regularization;
+    header.bandwidth = bandwidth;
+    header.deduplicate = deduplicate;
+    header.dedup_epsilon = dedup_epsilon;
+    header.recovery = recovery;
+    std::copy(recovery_alpha, recovery_alpha + 2, header.recovery_alpha);
+    header.global_init = global_init;
+    if (!recorder.open(record_file, header)) {
+      std::cerr << "Error: Could not create session log " << record_file
+                << std::endl;
+      return -1;
+    }
+    session_recorder = &recorder;
+  }
+  std::signal(SIGINT, stopServer);
+  std::signal(SIGTERM, stopServer);
+
+  // Per-stage latency report, dumped on SIGUSR1 or served on GET /latency
+  std::signal(SIGUSR1, requestLatencyDump);
+
+  h.onMessage([&pf,&map,&delta_t,&sensor_range,&sigma_pos,&sigma_landmark,
+               &send_pose_estimate,&send_associations,&recorder,&map_store,&tiled,&live_map,
+               &live_map_reader,&auxiliary,&pose_voter,&global_init]
               (uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length,
                uWS::OpCode opCode) {
+    if (latency_dump_requested) {
+      latency_dump_requested = 0;
+      std::cerr << latency_stats().report();
+    }
+
     // "42" at the start of the message means there's a websocket message event.
     // The 4 signifies a websocket message
     // The 2 signifies a websocket event
     if (length && length > 2 && data[0] == '4' && data[1] == '2') {
+      uint64_t const parse_start = latency_now();
       auto s = hasData(string(data));
 
       if (s != "") {
         auto j = json::parse(s);
+        latency_stats().record(STAGE_JSON_PARSE, latency_now() - parse_start);
 
         string event = j[0].get<string>();
 
         if (event == "telemetry") {
           // j[1] is the data JSON object
+          uint32_t frame_kind;
+          double control[3] = {0.0, 0.0, 0.0};
           if (!pf.initialized()) {
             // Sense noisy position data from the simulator
             double sense_x = std::stod(j[1]["sense_x"].get<string>());
             double sense_y = std::stod(j[1]["sense_y"].get<string>());
             double sense_theta = std::stod(j[1]["sense_theta"].get<string>());
 
-            pf.init(sense_x, sense_y, sense_theta, sigma_pos);
+            // (the filter is initialized once the observations are parsed,
+            // below, as the global initialization votes with them)
+            frame_kind = session_frame_s::INIT;
+            control[0] = sense_x;
+            control[1] = sense_y;
+            control[2] = sense_theta;
           } else {
             // Predict the vehicle's next state from previous
             //   (noiseless control) data.
             double previous_velocity = std::stod(j[1]["previous_velocity"].get<string>());
             double previous_yawrate = std::stod(j[1]["previous_yawrate"].get<string>());
 
-            pf.prediction(delta_t, sigma_pos, previous_velocity, previous_yawrate);
+            // (the auxiliary filter predicts in its update, below)
+            if (!auxiliary) {
+              pf.prediction(delta_t, sigma_pos, previous_velocity, previous_yawrate);
+            }
+            frame_kind = session_frame_s::PREDICTION;
+            control[0] = previous_velocity;
+            control[1] = previous_yawrate;
           }
 
           // receive noisy observation data from the simulator
@@ -86,18 +380,18 @@ int main() {
           string sense_observations_x = j[1]["sense_observations_x"];
           string sense_observations_y = j[1]["sense_observations_y"];
 
-          vector<float> x_sense;
+          vector<pf_real> x_sense;
           std::istringstream iss_x(sense_observations_x);
 
-          std::copy(std::istream_iterator<float>(iss_x),
-          std::istream_iterator<float>(),
+          std::copy(std::istream_iterator<pf_real>(iss_x),
+          std::istream_iterator<pf_real>(),
           std::back_inserter(x_sense));
 
-          vector<float> y_sense;
+          vector<pf_real> y_sense;
           std::istringstream iss_y(sense_observations_y);
 
-          std::copy(std::istream_iterator<float>(iss_y),
-          std::istream_iterator<float>(),
+          std::copy(std::istream_iterator<pf_real>(iss_y),
+          std::istream_iterator<pf_real>(),
           std::back_inserter(y_sense));
 
           for (int i = 0; i < x_sense.size(); ++i) {
@@ -107,43 +401,164 @@ int main() {
             noisy_observations.push_back(obs);
           }
 
+          recorder.record(frame_kind, control[0], control[1], control[2],
+                          noisy_observations);
+
+          // Map of the frame, pinned until the reply is sent
+          const Map *frame_map = &map;
+          if (live_map) {
+            frame_map = &live_map->pin(live_map_reader);
+          }
+
+          if (frame_kind == session_frame_s::INIT) {
+            // The landmark corrections received so far are voted on too
+            if (global_init > 0) {
+              setup_pose_voter(pose_voter, *frame_map, sensor_range,
+                               sigma_landmark);
+            }
+            vector<PoseCandidate> candidates;
+            init_filter(pf, pose_voter, global_init, noisy_observations,
+                        control[0], control[1], control[2], sigma_pos,
+                        candidates);
+            if (!candidates.empty()) {
+              async_logger().log(LOG_INFO, "global_init",
+                                 "candidates=%zu x=%.3f y=%.3f theta=%.4f "
+                                 "matched=%d votes=%d", candidates.size(),
+                                 candidates[0].x, candidates[0].y,
+                                 candidates[0].theta, candidates[0].matched,
+                                 candidates[0].votes);
+            } else if (global_init > 0) {
+              async_logger().log(LOG_WARN, "global_init",
+                                 "no pose voted, initialized from GPS");
+            }
+          }
+
           // Update the weights and resample
-          pf.updateWeights(sensor_range, sigma_landmark, noisy_observations, map);
-          pf.resample();
+          if (tiled) {
+            // Only the tiles around the particles are resident
+            double min_x, min_y, max_x, max_y, heading;
+            cloudBounds(pf.particles, min_x, min_y, max_x, max_y, heading);
+            double const velocity =
+                frame_kind == session_frame_s::PREDICTION ? control[0] : 0.0;
+            // The auxiliary filter has not moved the particles yet
+            double const margin = sensor_range +
+                                  (auxiliary ? fabs(velocity) * delta_t : 0.0);
+            frame_map = &map_store.update(min_x - margin, min_y - margin,
+                                          max_x + margin, max_y + margin,
+                                          heading, velocity, 5.0);
+          }
+          if (auxiliary && frame_kind == session_frame_s::PREDICTION) {
+            pf.auxiliaryUpdate(delta_t, sigma_pos, control[0], control[1],
+                               sensor_range, sigma_landmark,
+                               noisy_observations, *frame_map);
+          } else {
+            pf.updateWeights(sensor_range, sigma_landmark, noisy_observations,
+                             *frame_map);
+
+            // The auxiliary filter resamples at the start of the next frame
+            if (!auxiliary) {
+              pf.resample();
+            }
+          }
 
           // Calculate and output the average weighted error of the particle
           //   filter over all time steps so far.
-          vector<Particle> particles = pf.particles;
+          const vector<Particle> &particles = pf.particles;
           int num_particles = particles.size();
           double highest_weight = -1.0;
-          Particle best_particle;
+          int best_index = 0;
           double weight_sum = 0.0;
           for (int i = 0; i < num_particles; ++i) {
             if (particles[i].weight > highest_weight) {
               highest_weight = particles[i].weight;
-              best_particle = particles[i];
+              best_index = i;
             }
 
             weight_sum += particles[i].weight;
           }
+          Particle &best_particle = pf.particles[best_index];
 
-          std::cout << "highest w " << highest_weight << std::endl;
-          std::cout << "average w " << weight_sum/num_particles << std::endl;
+          async_logger().log(LOG_INFO, "weights",
+                             "highest=%g average=%g skipped_observations=%llu",
+                             highest_weight, weight_sum/num_particles,
+                             static_cast<unsigned long long>(
+                                 pf.skippedObservations()));
+          if (pf.injectionProbability() > 0.0) {
+            async_logger().log(LOG_WARN, "recovery",
+                               "injection_probability=%.3f injected=%llu",
+                               pf.injectionProbability(),
+                               static_cast<unsigned long long>(
+                                   pf.injectedParticles()));
+          }
+          if (pf.likelihoodReuses() > 0) {
+            async_logger().log(LOG_INFO, "likelihood",
+                               "evaluations=%llu reuses=%llu hit_rate=%.3f",
+                               static_cast<unsigned long long>(
+                                   pf.likelihoodEvaluations()),
+                               static_cast<unsigned long long>(
+                                   pf.likelihoodReuses()),
+                               static_cast<double>(pf.likelihoodReuses()) /
+                               (pf.likelihoodReuses() +
+                                pf.likelihoodEvaluations()));
+          }
+          if (pf.resampledDuplicates() > 0) {
+            async_logger().log(LOG_INFO, "resample",
+                               "duplicates=%llu separated=%.3f",
+                               static_cast<unsigned long long>(
+                                   pf.resampledDuplicates()),
+                               static_cast<double>(pf.separatedDuplicates()) /
+                               pf.resampledDuplicates());
+          }
 
-          json msgJson;
-          msgJson["best_particle_x"] = best_particle.x;
-          msgJson["best_particle_y"] = best_particle.y;
-          msgJson["best_particle_theta"] = best_particle.theta;
+          uint64_t const reply_start = latency_now();
+          // Allocated by onConnection
+          ReplyWriter *reply = static_cast<ReplyWriter *>(ws.getData());
+          reply->begin("best_particle");
+          reply->field("best_particle_x", best_particle.x);
+          reply->field("best_particle_y", best_particle.y);
+          reply->field("best_particle_theta", best_particle.theta);
+
+          // Optional weighted mean and covariance of the particle set
+          if (send_pose_estimate) {
+            const PoseEstimate &estimate = pf.poseEstimate();
+            reply->field("estimate_x", estimate.x);
+            reply->field("estimate_y", estimate.y);
+            reply->field("estimate_theta", estimate.theta);
+            reply->field("estimate_cov", &estimate.cov[0][0], 9);
+          }
 
           // Optional message data used for debugging particle's sensing
           //   and associations
-          msgJson["best_particle_associations"] = pf.getAssociations(best_particle);
-          msgJson["best_particle_sense_x"] = pf.getSenseCoord(best_particle, "X");
-          msgJson["best_particle_sense_y"] = pf.getSenseCoord(best_particle, "Y");
+          if (send_associations) {
+            pf.captureAssociations(best_particle, sensor_range,
+                                   noisy_observations, *frame_map);
+          }
+          const association_s *records = pf.associationRecords(best_particle);
+          uint32_t const num_records =
+              records != NULL ? best_particle.associations.count : 0;
+          reply->beginList("best_particle_associations");
+          for (uint32_t k = 0; k < num_records; ++k) {
+            reply->item(records[k].id);
+          }
+          reply->endList();
+          reply->beginList("best_particle_sense_x");
+          for (uint32_t k = 0; k < num_records; ++k) {
+            reply->item(records[k].sense_x);
+          }
+          reply->endList();
+          reply->beginList("best_particle_sense_y");
+          for (uint32_t k = 0; k < num_records; ++k) {
+            reply->item(records[k].sense_y);
+          }
+          reply->endList();
+          reply->end();
+
+          ws.send(reply->data(), reply->size(), uWS::OpCode::TEXT);
+          latency_stats().record(STAGE_REPLY, latency_now() - reply_start);
 
-          auto msg = "42[\"best_particle\"," + msgJson.dump() + "]";
-          // std::cout << msg << std::endl;
-          ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+          if (live_map) {
+            live_map->unpin(live_map_reader);
+          }
         }  // end "telemetry" if
       } else {
         string msg = "42[\"manual\",{}]";
@@ -152,12 +567,67 @@ int main() {
     }  // end websocket message if
   }); // end h.onMessage
 
+  h.onHttpRequest([&live_map](uWS::HttpResponse *res, uWS::HttpRequest req,
+                              char *data, size_t length,
+                              size_t remainingBytes) {
+    string const url = req.getUrl().toString();
+    if (url == "/latency") {
+      string report = latency_stats().report();
+      res->end(report.data(), report.length());
+    } else if (url == "/landmarks" && req.getMethod() == uWS::METHOD_POST) {
+      // Landmark corrections:
+      //   {"upsert": [{"id": 1, "x": 10.5, "y": -3.2}, ...], "remove": [7, ...]}
+      string reply;
+      if (!live_map) {
+        reply = "error: map updates are disabled (--accept-map-updates)\n";
+      } else if (!isLoopback(res->httpSocket->getAddress().address)) {
+        reply = "error: map updates are only accepted from the local host\n";
+      } else if (remainingBytes > 0) {
+        reply = "error: the batch must fit in a single request chunk\n";
+      } else {
+        try {
+          json const body = json::parse(string(data, length));
+          landmark_batch_s batch;
+          if (body.count("upsert")) {
+            for (const json &entry : body["upsert"]) {
+              Map::single_landmark_s landmark;
+              landmark.id_i = entry["id"].get<int64_t>();
+              landmark.x_f = entry["x"].get<float>();
+              landmark.y_f = entry["y"].get<float>();
+              if (!std::isfinite(landmark.x_f) ||
+                  !std::isfinite(landmark.y_f)) {
+                throw std::invalid_argument("non-finite landmark position");
+              }
+              batch.upserts.push_back(landmark);
+            }
+          }
+          if (body.count("remove")) {
+            for (const json &id : body["remove"]) {
+              batch.removals.push_back(id.get<int64_t>());
+            }
+          }
+          live_map->submit(batch);
+          reply = "queued\n";
+        } catch (const std::exception &e) {
+          reply = string("error: ") + e.what() + "\n";
+        }
+      }
+      res->end(reply.data(), reply.length());
+    } else {
+      res->end(nullptr, 0);
+    }
+  });
+
   h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+    // Reply buffer of the connection, reused for every frame
+    ws.setData(new ReplyWriter());
     std::cout << "Connected!!!" << std::endl;
   });
 
   h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code,
                          char *message, size_t length) {
+    delete static_cast<ReplyWriter *>(ws.getData());
+    ws.setData(nullptr);
     ws.close();
     std::cout << "Disconnected" << std::endl;
   });
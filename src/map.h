@@ -8,17 +8,449 @@
 #ifndef MAP_H_
 #define MAP_H_
 
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 class Map {
- public:  
+ public:
   struct single_landmark_s {
-    int id_i ; // Landmark ID
+    int64_t id_i ; // Landmark ID (external, possibly sparse)
     float x_f; // Landmark x-position in the map (global coordinates)
     float y_f; // Landmark y-position in the map (global coordinates)
   };
 
+  // Landmark as stored in the grid index
+  struct cell_landmark_s {
+    float x_f; // Landmark x-position in the map (global coordinates)
+    float y_f; // Landmark y-position in the map (global coordinates)
+    int index; // Index of the landmark in landmark_list
+  };
+
   std::vector<single_landmark_s> landmark_list; // List of landmarks in the map
+
+  /**
+   * buildIdLookup Builds the lookup table from the external landmark ids to
+   *   their (dense, 0-based) index in the landmark list. Internally the filter
+   *   refers to landmarks by index, ids are only translated at the boundaries.
+   *   Must be called again if the list changes.
+   */
+  void buildIdLookup() {
+    std::vector<std::unordered_map<int64_t, int> > shards(kIdShards);
+    for (size_t i = 0; i < landmark_list.size(); ++i) {
+      shards[idShard(landmark_list[i].id_i)][landmark_list[i].id_i] =
+          static_cast<int>(i);
+    }
+    id_shards.assign(kIdShards, id_shard_ptr());
+    for (int s = 0; s < kIdShards; ++s) {
+      if (!shards[s].empty()) {
+        id_shards[s] = std::make_shared<id_shard_t>(std::move(shards[s]));
+      }
+    }
+  }
+
+  /**
+   * updateIdLookup Updates the lookup table of a copy of a map whose
+   *   landmarks changed at a few indices. Only the shards of the table with
+   *   the ids of those landmarks are rebuilt, the others stay shared with the
+   *   original map.
+   * @param base Map this one was copied from, before its list was changed
+   * @param changed Sorted indices of the changed landmarks, in either list
+   */
+  void updateIdLookup(const Map &base, const std::vector<int> &changed) {
+    if (base.id_shards.empty()) {
+      buildIdLookup();
+      return;
+    }
+
+    // Copies of the shards touched, from the base
+    std::vector<std::unordered_map<int64_t, int> > copies(kIdShards);
+    std::vector<bool> touched(kIdShards, false);
+    for (size_t c = 0; c < changed.size(); ++c) {
+      int const k = changed[c];
+      if (k < static_cast<int>(base.landmark_list.size())) {
+        touchIdShard(idShard(base.landmark_list[k].id_i), copies, touched);
+      }
+      if (k < static_cast<int>(landmark_list.size())) {
+        touchIdShard(idShard(landmark_list[k].id_i), copies, touched);
+      }
+    }
+
+    // The ids previously at the changed indices are removed first, then the
+    // ids now at those indices are added
+    for (size_t c = 0; c < changed.size(); ++c) {
+      int const k = changed[c];
+      if (k < static_cast<int>(base.landmark_list.size())) {
+        int64_t const id = base.landmark_list[k].id_i;
+        std::unordered_map<int64_t, int> &shard = copies[idShard(id)];
+        std::unordered_map<int64_t, int>::iterator it = shard.find(id);
+        if (it != shard.end() && it->second == k) {
+          shard.erase(it);
+        }
+      }
+    }
+    for (size_t c = 0; c < changed.size(); ++c) {
+      int const k = changed[c];
+      if (k < static_cast<int>(landmark_list.size())) {
+        int64_t const id = landmark_list[k].id_i;
+        copies[idShard(id)][id] = k;
+      }
+    }
+
+    for (int s = 0; s < kIdShards; ++s) {
+      if (touched[s]) {
+        id_shards[s] = copies[s].empty() ? id_shard_ptr() :
+            std::make_shared<id_shard_t>(std::move(copies[s]));
+      }
+    }
+  }
+
+  /**
+   * indexOf Returns the index in the landmark list of the landmark with the
+   *   given external id, or -1 if there is no such landmark.
+   */
+  int indexOf(int64_t id) const {
+    if (id_shards.empty()) {
+      return -1;
+    }
+    const id_shard_t *shard = id_shards[idShard(id)].get();
+    if (shard == NULL) {
+      return -1;
+    }
+    id_shard_t::const_iterator it = shard->find(id);
+    return it == shard->end() ? -1 : it->second;
+  }
+
+  /**
+   * buildIndex Builds a uniform grid index over the landmark list, used to
+   *   retrieve the landmarks around a position without scanning the map.
+   *   The grid is split in blocks of kIndexBlock x kIndexBlock cells, and
+   *   the landmarks of a block are copied in cell order, so the landmarks of
+   *   a row of cells are contiguous in memory. Must be called again (or
+   *   updateIndex) if the list changes.
+   * @param cell_size Side of the grid cells [m]
+   */
+  void buildIndex(float cell_size) {
+    index_blocks.clear();
+    if (landmark_list.empty()) {
+      return;
+    }
+
+    grid_cell = cell_size;
+    grid_min_x = grid_max_x = landmark_list[0].x_f;
+    grid_min_y = grid_max_y = landmark_list[0].y_f;
+    for (size_t i = 1; i < landmark_list.size(); ++i) {
+      grid_min_x = std::min(grid_min_x, landmark_list[i].x_f);
+      grid_max_x = std::max(grid_max_x, landmark_list[i].x_f);
+      grid_min_y = std::min(grid_min_y, landmark_list[i].y_f);
+      grid_max_y = std::max(grid_max_y, landmark_list[i].y_f);
+    }
+    grid_origin_x = grid_min_x;
+    grid_origin_y = grid_min_y;
+    int const nx = static_cast<int>((grid_max_x - grid_min_x) / grid_cell) + 1;
+    int const ny = static_cast<int>((grid_max_y - grid_min_y) / grid_cell) + 1;
+    grid_nbx = (nx + kIndexBlock - 1) / kIndexBlock;
+    grid_nby = (ny + kIndexBlock - 1) / kIndexBlock;
+    grid_nx = grid_nbx * kIndexBlock;
+    grid_ny = grid_nby * kIndexBlock;
+
+    // Landmarks of each block, in list order
+    std::vector<std::vector<cell_landmark_s> > members(grid_nbx * grid_nby);
+    for (size_t i = 0; i < landmark_list.size(); ++i) {
+      members[blockOf(landmark_list[i])].push_back(
+          cellLandmark(static_cast<int>(i)));
+    }
+    index_blocks.assign(members.size(), block_ptr());
+    for (size_t b = 0; b < members.size(); ++b) {
+      index_blocks[b] = makeBlock(b, members[b]);
+    }
+  }
+
+  /**
+   * updateIndex Updates the grid index of a copy of a map whose landmarks
+   *   changed at a few indices. Only the blocks of the grid where landmarks
+   *   were added, moved or removed are rebuilt, the others stay shared with
+   *   the original map. The grid grows by whole blocks to cover the new
+   *   landmarks (it never shrinks).
+   * @param base Map this one was copied from, before its list was changed
+   *   (its index must have been built)
+   * @param changed Sorted indices of the changed landmarks, in either list
+   */
+  void updateIndex(const Map &base, const std::vector<int> &changed) {
+    int const size = landmark_list.size();
+    int const base_size = base.landmark_list.size();
+
+    // Grow the grid by whole blocks if landmarks were added outside of it,
+    // so that the blocks keep their position
+    for (size_t c = 0; c < changed.size(); ++c) {
+      if (changed[c] < size) {
+        const single_landmark_s &landmark = landmark_list[changed[c]];
+        grid_min_x = std::min(grid_min_x, landmark.x_f);
+        grid_max_x = std::max(grid_max_x, landmark.x_f);
+        grid_min_y = std::min(grid_min_y, landmark.y_f);
+        grid_max_y = std::max(grid_max_y, landmark.y_f);
+      }
+    }
+    double const block_side = static_cast<double>(grid_cell) * kIndexBlock;
+    int const grow_x0 = blocksBefore(grid_min_x, grid_origin_x, block_side);
+    int const grow_y0 = blocksBefore(grid_min_y, grid_origin_y, block_side);
+    int const nbx = std::max(grid_nbx + grow_x0, cellCoord(grid_max_x,
+        grid_origin_x - grow_x0 * block_side) / kIndexBlock + 1);
+    int const nby = std::max(grid_nby + grow_y0, cellCoord(grid_max_y,
+        grid_origin_y - grow_y0 * block_side) / kIndexBlock + 1);
+    if (nbx != grid_nbx || nby != grid_nby) {
+      std::vector<block_ptr> grown(nbx * nby);
+      for (int by = 0; by < grid_nby; ++by) {
+        for (int bx = 0; bx < grid_nbx; ++bx) {
+          grown[(by + grow_y0) * nbx + bx + grow_x0] =
+              index_blocks[by * grid_nbx + bx];
+        }
+      }
+      index_blocks.swap(grown);
+      grid_origin_x -= grow_x0 * block_side;
+      grid_origin_y -= grow_y0 * block_side;
+      grid_nbx = nbx;
+      grid_nby = nby;
+      grid_nx = grid_nbx * kIndexBlock;
+      grid_ny = grid_nby * kIndexBlock;
+    }
+
+    // Blocks with a changed landmark, at its previous or current position
+    std::vector<int> dirty;
+    for (size_t c = 0; c < changed.size(); ++c) {
+      int const k = changed[c];
+      if (k < base_size) {
+        dirty.push_back(blockOf(base.landmark_list[k]));
+      }
+      if (k < size) {
+        dirty.push_back(blockOf(landmark_list[k]));
+      }
+    }
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    // A dirty block keeps its unchanged landmarks (in the same order), and
+    // gets the changed landmarks now in it
+    std::vector<cell_landmark_s> members;
+    for (size_t d = 0; d < dirty.size(); ++d) {
+      int const b = dirty[d];
+      members.clear();
+      if (index_blocks[b]) {
+        const std::vector<cell_landmark_s> &old = index_blocks[b]->landmarks;
+        for (size_t k = 0; k < old.size(); ++k) {
+          if (!std::binary_search(changed.begin(), changed.end(),
+                                  old[k].index)) {
+            members.push_back(old[k]);
+          }
+        }
+      }
+      for (size_t c = 0; c < changed.size(); ++c) {
+        if (changed[c] < size && blockOf(landmark_list[changed[c]]) == b) {
+          members.push_back(cellLandmark(changed[c]));
+        }
+      }
+      index_blocks[b] = makeBlock(b, members);
+    }
+  }
+
+  /**
+   * hasIndex Returns whether the grid index has been built.
+   */
+  bool hasIndex() const {
+    return !index_blocks.empty();
+  }
+
+  /**
+   * memoryBytes Returns the (approximate) memory used by the landmarks, the
+   *   grid index and the id lookup table (blocks shared with other maps
+   *   included).
+   */
+  size_t memoryBytes() const {
+    size_t bytes = landmark_list.capacity() * sizeof(single_landmark_s) +
+                   index_blocks.capacity() * sizeof(block_ptr) +
+                   id_shards.capacity() * sizeof(id_shard_ptr);
+    for (size_t b = 0; b < index_blocks.size(); ++b) {
+      if (index_blocks[b]) {
+        bytes += sizeof(IndexBlock) +
+                 index_blocks[b]->cell_start.capacity() * sizeof(int) +
+                 index_blocks[b]->landmarks.capacity() *
+                 sizeof(cell_landmark_s);
+      }
+    }
+    for (size_t s = 0; s < id_shards.size(); ++s) {
+      if (id_shards[s]) {
+        bytes += id_shards[s]->size() * (sizeof(std::pair<const int64_t, int>) +
+                                         sizeof(void *)) +
+                 id_shards[s]->bucket_count() * sizeof(void *);
+      }
+    }
+    return bytes;
+  }
+
+  /**
+   * indexBounds Returns the bounding box of the landmarks, as computed by
+   *   buildIndex (only valid if the index has been built).
+   */
+  void indexBounds(float &min_x, float &min_y, float &max_x,
+                   float &max_y) const {
+    min_x = grid_min_x;
+    min_y = grid_min_y;
+    max_x = grid_max_x;
+    max_y = grid_max_y;
+  }
+
+  /**
+   * forEachInRange Visits (at least) all the landmarks within range from a
+   *   position, using the grid index. Landmarks in the cells overlapping the
+   *   square around the position are visited, so the caller still has to
+   *   check the actual distance.
+   * @param (x,y) Position [m]
+   * @param range Range [m]
+   * @param visit Callable taking a const cell_landmark_s&
+   */
+  template <typename Visitor>
+  void forEachInRange(double x, double y, double range, Visitor visit) const {
+    int const cx0 = std::max(0, cellCoord(x - range, grid_origin_x));
+    int const cx1 = std::min(grid_nx - 1, cellCoord(x + range, grid_origin_x));
+    int const cy0 = std::max(0, cellCoord(y - range, grid_origin_y));
+    int const cy1 = std::min(grid_ny - 1, cellCoord(y + range, grid_origin_y));
+    if (cx0 > cx1 || cy0 > cy1) {
+      return;
+    }
+
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      const block_ptr *row = &index_blocks[(cy / kIndexBlock) * grid_nbx];
+      int const row_start = (cy % kIndexBlock) * kIndexBlock;
+      for (int bx = cx0 / kIndexBlock; bx <= cx1 / kIndexBlock; ++bx) {
+        const IndexBlock *block = row[bx].get();
+        if (block == NULL) {
+          continue;
+        }
+        // Cells of a row of the block are contiguous, so is their range of
+        // landmarks
+        int const lx0 = std::max(0, cx0 - bx * kIndexBlock);
+        int const lx1 = std::min(kIndexBlock - 1, cx1 - bx * kIndexBlock);
+        int const first = block->cell_start[row_start + lx0];
+        int const last = block->cell_start[row_start + lx1 + 1];
+        for (int k = first; k < last; ++k) {
+          visit(block->landmarks[k]);
+        }
+      }
+    }
+  }
+
+ private:
+  // Side of the blocks of the grid index [cells], and number of shards of
+  // the id lookup table
+  static const int kIndexBlock = 8;
+  static const int kIdShards = 1024;
+
+  // Block of the grid index, immutable once built (shared between copies)
+  struct IndexBlock {
+    std::vector<int> cell_start;              // First landmark of each cell
+    std::vector<cell_landmark_s> landmarks;   // Landmarks in cell order
+  };
+  typedef std::shared_ptr<const IndexBlock> block_ptr;
+  typedef std::unordered_map<int64_t, int> id_shard_t;
+  typedef std::shared_ptr<const id_shard_t> id_shard_ptr;
+
+  int cellCoord(double v, double grid_origin) const {
+    double const c = floor((v - grid_origin) / grid_cell);
+    // Clamp before converting, positions can be far outside the grid
+    return static_cast<int>(std::max(-1.0, std::min(c, 1e9)));
+  }
+
+  int blockOf(const single_landmark_s &landmark) const {
+    return (cellCoord(landmark.y_f, grid_origin_y) / kIndexBlock) * grid_nbx +
+           cellCoord(landmark.x_f, grid_origin_x) / kIndexBlock;
+  }
+
+  // Number of whole blocks to add before the origin to cover v
+  int blocksBefore(float v, double origin, double block_side) const {
+    if (v >= origin) {
+      return 0;
+    }
+    int blocks = static_cast<int>(ceil((origin - v) / block_side));
+    while (cellCoord(v, origin - blocks * block_side) < 0) {
+      ++blocks;
+    }
+    return blocks;
+  }
+
+  cell_landmark_s cellLandmark(int index) const {
+    cell_landmark_s landmark;
+    landmark.x_f = landmark_list[index].x_f;
+    landmark.y_f = landmark_list[index].y_f;
+    landmark.index = index;
+    return landmark;
+  }
+
+  /**
+   * makeBlock Builds a block of the grid index (stable counting sort of its
+   *   landmarks by cell), or returns an empty pointer if it has no landmark.
+   * @param b Index of the block
+   * @param members Landmarks in the block
+   */
+  block_ptr makeBlock(int b,
+                      const std::vector<cell_landmark_s> &members) const {
+    if (members.empty()) {
+      return block_ptr();
+    }
+    int const cx0 = (b % grid_nbx) * kIndexBlock;
+    int const cy0 = (b / grid_nbx) * kIndexBlock;
+    std::vector<int> cells(members.size());
+
+    std::shared_ptr<IndexBlock> block = std::make_shared<IndexBlock>();
+    block->cell_start.assign(kIndexBlock * kIndexBlock + 1, 0);
+    for (size_t m = 0; m < members.size(); ++m) {
+      int const lx = cellCoord(members[m].x_f, grid_origin_x) - cx0;
+      int const ly = cellCoord(members[m].y_f, grid_origin_y) - cy0;
+      cells[m] = ly * kIndexBlock + lx;
+      ++block->cell_start[cells[m] + 1];
+    }
+    for (size_t c = 1; c < block->cell_start.size(); ++c) {
+      block->cell_start[c] += block->cell_start[c - 1];
+    }
+    std::vector<int> fill(block->cell_start.begin(),
+                          block->cell_start.end() - 1);
+    block->landmarks.resize(members.size());
+    for (size_t m = 0; m < members.size(); ++m) {
+      block->landmarks[fill[cells[m]]++] = members[m];
+    }
+    return block;
+  }
+
+  static int idShard(int64_t id) {
+    // Fibonacci hashing: ids are often sequential
+    return static_cast<int>((static_cast<uint64_t>(id) *
+                             0x9E3779B97F4A7C15ull) >> 54);
+  }
+
+  void touchIdShard(int s, std::vector<id_shard_t> &copies,
+                    std::vector<bool> &touched) const {
+    if (!touched[s]) {
+      touched[s] = true;
+      if (id_shards[s]) {
+        copies[s] = *id_shards[s];
+      }
+    }
+  }
+
+  // Grid index (see buildIndex): bounding box of the landmarks, origin and
+  // size of the grid, and its blocks (row-major, empty if no landmark)
+  float grid_cell;
+  float grid_min_x, grid_max_x, grid_min_y, grid_max_y;
+  double grid_origin_x, grid_origin_y;
+  int grid_nx, grid_ny;
+  int grid_nbx, grid_nby;
+  std::vector<block_ptr> index_blocks;
+
+  // External landmark id to index in landmark_list (see buildIdLookup),
+  // sharded by id
+  std::vector<id_shard_ptr> id_shards;
 };
 
 #endif  // MAP_H_
@@ -0,0 +1,205 @@
+/**
+ * measurement_models.h
+ * Measurement model of the landmark observations used by the update step,
+ * shared by ParticleFilter and the measurement policy of
+ * StaticParticleFilter: range query of the map, transform of the
+ * observations to map coordinates, nearest neighbor association and
+ * bivariate Gaussian likelihood.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef MEASUREMENT_MODELS_H_
+#define MEASUREMENT_MODELS_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <limits>
+#include <vector>
+#include "helper_functions.h"
+#include "map.h"
+
+// Gate [squared Mahalanobis distance] whose boundary density scores the
+// outliers when association is not gated: the 99.9% of the 2 DOF chi-square
+const double kDefaultOutlierGate = 13.82;
+
+/**
+ * landmarks_in_range Appends the landmarks within range from a position,
+ *   using the grid index of the map if it has been built.
+ * @param map_landmarks Map class containing map landmarks
+ * @param (x,y) Position [m]
+ * @param range Range [m]
+ * @param in_range Vector the landmarks in range are appended to (id: index
+ *   of the landmark in the map)
+ */
+inline void landmarks_in_range(const Map &map_landmarks, pf_real x, pf_real y,
+                               pf_real range,
+                               std::vector<LandmarkObs> &in_range) {
+  LandmarkObs currentLandmark;
+
+  if (map_landmarks.hasIndex()) {
+    // Visit only the grid cells around the position
+    map_landmarks.forEachInRange(x, y, range,
+        [&](const Map::cell_landmark_s &landmark) {
+      if (dist(x, y, landmark.x_f, landmark.y_f) <= range) {
+        currentLandmark.x = landmark.x_f;
+        currentLandmark.y = landmark.y_f;
+        currentLandmark.id = landmark.index;
+        in_range.push_back(currentLandmark);
+      }
+    });
+    return;
+  }
+
+  // Iterate over landmarks in the map
+  for (size_t k = 0; k < map_landmarks.landmark_list.size(); k++) {
+    currentLandmark.x = map_landmarks.landmark_list[k].x_f;
+    currentLandmark.y = map_landmarks.landmark_list[k].y_f;
+    currentLandmark.id = k;  // Landmarks are referred to by index
+
+    // check if landmark is in range from the position
+    if (dist(x, y, currentLandmark.x, currentLandmark.y) <= range) {
+      in_range.push_back(currentLandmark);
+    }
+  }
+}
+
+/**
+ * Transform of the observations of a particle from vehicle to map
+ *   coordinates.
+ */
+struct ObservationTransform {
+  ObservationTransform(pf_real x, pf_real y, pf_real theta)
+      : xp(x), yp(y), cos_theta(cos(theta)), sin_theta(sin(theta)) {}
+
+  void apply(const LandmarkObs &obs, pf_real &xm, pf_real &ym) const {
+    xm = xp + obs.x * cos_theta - obs.y * sin_theta;
+    ym = yp + obs.x * sin_theta + obs.y * cos_theta;
+  }
+
+  pf_real xp;
+  pf_real yp;
+  pf_real cos_theta;
+  pf_real sin_theta;
+};
+
+/**
+ * Bivariate Gaussian likelihood of an observation given its landmark, and
+ *   the association gate and outlier likelihood that go with it.
+ */
+struct GaussianLikelihood {
+  GaussianLikelihood() : coeffx(0.5), coeffy(0.5), coeffnorm(0.5 / M_PI),
+                         log_norm(log(0.5 / M_PI)), inv_var_x(1.0),
+                         inv_var_y(1.0), gate(0.0), outlier(0.0) {}
+
+  /**
+   * configure Sets the constants of a frame.
+   * @param std_landmark[] Landmark measurement uncertainty [x [m], y [m]]
+   * @param chi2_gate Gate on the squared Mahalanobis distance, 0 for none
+   * @param outlier_probability Likelihood of an observation without
+   *   landmark, 0 for the density on the gate boundary (on the boundary of
+   *   kDefaultOutlierGate without gate), so that an outlier never scores
+   *   more than an associated observation
+   */
+  void configure(const double std_landmark[], double chi2_gate,
+                 double outlier_probability) {
+    double const sigma_x = std_landmark[0];
+    double const sigma_y = std_landmark[1];
+    coeffx = 1.0 / (2 * sigma_x * sigma_x);
+    coeffy = 1.0 / (2 * sigma_y * sigma_y);
+    coeffnorm = 1.0 / (2 * M_PI * sigma_x * sigma_y);
+    log_norm = log(coeffnorm);
+    inv_var_x = 1.0 / (sigma_x * sigma_x);
+    inv_var_y = 1.0 / (sigma_y * sigma_y);
+    gate = chi2_gate;
+    double const boundary = gate > 0.0 ? gate : kDefaultOutlierGate;
+    outlier = outlier_probability > 0.0 ? outlier_probability :
+              coeffnorm * exp(-0.5 * boundary);
+  }
+
+  /**
+   * score Returns the likelihood of an observation at (dx,dy) [m] from its
+   *   landmark, in double precision: products of many of them underflow a
+   *   float.
+   */
+  double score(pf_real dx, pf_real dy) const {
+    pf_real const exponent = dx * dx * coeffx + dy * dy * coeffy;
+    return coeffnorm * exp(-static_cast<double>(exponent));
+  }
+
+  /**
+   * logScore Returns the log of score.
+   */
+  double logScore(pf_real dx, pf_real dy) const {
+    return log_norm - 0.5 * (dx * dx * inv_var_x + dy * dy * inv_var_y);
+  }
+
+  /**
+   * nearest Finds the landmark closest to an observation. Without a gate,
+   *   the squared Euclidean distance is used (same nearest neighbor as the
+   *   Euclidean one), otherwise the squared Mahalanobis distance, bounded by
+   *   the gate. Candidates are rejected on the x component alone if
+   *   possible.
+   * @param predicted Landmarks in range
+   * @param (xo,yo) Observation in map coordinates [m]
+   * @output Index in predicted of the closest landmark, -1 if none is
+   *   within the gate
+   */
+  int nearest(const std::vector<LandmarkObs> &predicted, pf_real xo,
+              pf_real yo) const {
+    bool const gated = gate > 0.0;
+    pf_real const wx = gated ? inv_var_x : 1.0;
+    pf_real const wy = gated ? inv_var_y : 1.0;
+
+    pf_real min_dist = gated ? gate : std::numeric_limits<pf_real>::infinity();
+    int min_index = -1;
+    for (size_t j = 0; j < predicted.size(); ++j) {
+      pf_real const dx = predicted[j].x - xo;
+      pf_real const dist_x = wx * dx * dx;
+      if (dist_x >= min_dist) {
+        continue;
+      }
+
+      pf_real const dy = predicted[j].y - yo;
+      pf_real const current_dist = dist_x + wy * dy * dy;
+      if (current_dist < min_dist) {
+        min_dist = current_dist;
+        min_index = j;
+      }
+    }
+    return min_index;
+  }
+
+  pf_real coeffx;     // 1 / (2 sigma_x^2)
+  pf_real coeffy;     // 1 / (2 sigma_y^2)
+  double coeffnorm;   // 1 / (2 pi sigma_x sigma_y)
+  double log_norm;    // log(coeffnorm)
+  double inv_var_x;   // 1 / sigma_x^2
+  double inv_var_y;   // 1 / sigma_y^2
+  double gate;        // Gate on the squared Mahalanobis distance (0 = none)
+  double outlier;     // Likelihood of an observation without landmark
+};
+
+/**
+ * uniform_if_degenerate Sets all the weights to 1 if they do not sum to a
+ *   positive value (no particle explains the observations at all, or all
+ *   the likelihoods underflowed), so that the normalized weights are
+ *   uniform instead of NaN.
+ * @param particles Particles (anything with a weight member)
+ * @param count Number of particles
+ * @param cumulated_weight Sum of the weights
+ * @output Sum of the weights to normalize with
+ */
+template <class ParticleT>
+double uniform_if_degenerate(ParticleT *particles, size_t count,
+                             double cumulated_weight) {
+  if (cumulated_weight > 0.0) {
+    return cumulated_weight;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    particles[i].weight = 1.0;
+  }
+  return count;
+}
+
+#endif  // MEASUREMENT_MODELS_H_
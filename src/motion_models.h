@@ -0,0 +1,104 @@
+/**
+ * motion_models.h
+ * Motion models of the vehicle used by the prediction step.
+ *
+ * Every model turns the controls of a frame into a displacement expressed
+ * in the frame of the initial heading (forward, lateral) plus a heading
+ * change. These terms are the same for all the particles, so they are
+ * computed once per frame; moving a particle then costs one sin/cos of its
+ * own heading:
+ *   x     += forward * cos(theta) - lateral * sin(theta)
+ *   y     += forward * sin(theta) + lateral * cos(theta)
+ *   theta += dtheta
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef MOTION_MODELS_H_
+#define MOTION_MODELS_H_
+
+#include <math.h>
+#include "helper_functions.h"
+
+// Below this yaw rate [rad/s] the vehicle is considered driving straight
+const double kStraightYawRate = 0.00001;
+
+/**
+ * Frame-invariant terms of a motion model.
+ */
+struct MotionStep {
+  pf_real forward;  // Displacement along the initial heading [m]
+  pf_real lateral;  // Displacement to the left of the initial heading [m]
+  pf_real dtheta;   // Heading change [rad]
+};
+
+/**
+ * Straight line motion with constant acceleration (no yaw rate).
+ */
+struct StraightLineMotion {
+  static MotionStep step(double delta_t, double velocity,
+                         double acceleration) {
+    MotionStep s;
+    s.forward = velocity * delta_t + 0.5 * acceleration * delta_t * delta_t;
+    s.lateral = 0.0;
+    s.dtheta = 0.0;
+    return s;
+  }
+
+  static void apply(const MotionStep &s, pf_real &x, pf_real &y,
+                    pf_real &theta) {
+    x += s.forward * cos(theta);
+    y += s.forward * sin(theta);
+  }
+};
+
+/**
+ * Constant turn rate and velocity (CTRV) motion, the bicycle model.
+ */
+struct CtrvMotion {
+  static MotionStep step(double delta_t, double velocity, double yaw_rate) {
+    double const dtheta = yaw_rate * delta_t;
+    double const radius = velocity / yaw_rate;
+    MotionStep s;
+    s.forward = radius * sin(dtheta);
+    s.lateral = radius * (1.0 - cos(dtheta));
+    s.dtheta = dtheta;
+    return s;
+  }
+
+  static void apply(const MotionStep &s, pf_real &x, pf_real &y,
+                    pf_real &theta) {
+    pf_real const cos_theta = cos(theta);
+    pf_real const sin_theta = sin(theta);
+    x += s.forward * cos_theta - s.lateral * sin_theta;
+    y += s.forward * sin_theta + s.lateral * cos_theta;
+    theta += s.dtheta;
+  }
+};
+
+/**
+ * Constant turn rate and acceleration (CTRA) motion. Same kernel as CTRV,
+ *   only the frame terms change.
+ */
+struct CtraMotion {
+  static MotionStep step(double delta_t, double velocity, double yaw_rate,
+                         double acceleration) {
+    double const dtheta = yaw_rate * delta_t;
+    double const sin_d = sin(dtheta);
+    double const cos_d = cos(dtheta);
+    double const v_end = velocity + acceleration * delta_t;
+    double const a_term = acceleration / (yaw_rate * yaw_rate);
+    MotionStep s;
+    s.forward = v_end / yaw_rate * sin_d + a_term * (cos_d - 1.0);
+    s.lateral = (velocity - v_end * cos_d) / yaw_rate + a_term * sin_d;
+    s.dtheta = dtheta;
+    return s;
+  }
+
+  static void apply(const MotionStep &s, pf_real &x, pf_real &y,
+                    pf_real &theta) {
+    CtrvMotion::apply(s, x, y, theta);
+  }
+};
+
+#endif  // MOTION_MODELS_H_
@@ -11,15 +11,20 @@
 #include "particle_filter.h"
 
 #include <math.h>
+#include <string.h>
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <random>
 #include <string>
 #include <vector>
 
 #include "helper_functions.h"
+#include "latency_stats.h"
+#include "measurement_models.h"
+#include "motion_models.h"
 
 using std::string;
 using std::vector;
@@ -27,6 +32,9 @@ using std::normal_distribution;
 using std::uniform_int_distribution;
 using std::uniform_real_distribution;
 
+// Sub-stages of updateWeights are timed on one particle out of this many
+static const int kLatencySampleStride = 32;
+
 /**
  * init Initializes particle filter by initializing particles to Gaussian
  *   distribution around first position and all the weights to 1.
@@ -37,15 +45,17 @@ using std::uniform_real_distribution;
  *   standard deviation of y [m], standard deviation of yaw [rad]]
  */
 void ParticleFilter::init(double x, double y, double theta, double std[]) {
+  ScopedLatency latency(STAGE_INIT);
 
   // Set number of  particles
-  num_particles = 1000;
+  num_particles = configured_particles;
+  particles.clear();
 
   // Creates normal (Gaussian) distributions for x, y, theta, given the noises
   // and positions in input
-  normal_distribution<double> dist_x(x, std[0]);
-  normal_distribution<double> dist_y(y, std[1]);
-  normal_distribution<double> dist_theta(theta, std[2]);
+  normal_distribution<pf_real> dist_x(x, std[0]);
+  normal_distribution<pf_real> dist_y(y, std[1]);
+  normal_distribution<pf_real> dist_theta(theta, std[2]);
 
   // Creating a particle to assign data to
   Particle currentParticle;
@@ -69,6 +79,54 @@ void ParticleFilter::init(double x, double y, double theta, double std[]) {
   is_initialized = true;
 }
 
+/**
+ * initFromCandidates Initializes particle filter around the candidate poses
+ *   voted by the observations, with a number of particles per candidate
+ *   proportional to its votes.
+ * @param candidates Candidate poses (at least one)
+ * @param std[] Array of dimension 3 [standard deviation of x [m],
+ *   standard deviation of y [m], standard deviation of yaw [rad]]
+ */
+void ParticleFilter::initFromCandidates(
+    const vector<PoseCandidate> &candidates, double std[]) {
+  ScopedLatency latency(STAGE_INIT);
+
+  num_particles = configured_particles;
+  particles.clear();
+
+  int total_votes = 0;
+  for (size_t c = 0; c < candidates.size(); ++c) {
+    total_votes += candidates[c].votes;
+  }
+
+  normal_distribution<double> noise_x(0.0, std[0]);
+  normal_distribution<double> noise_y(0.0, std[1]);
+  normal_distribution<double> noise_theta(0.0, std[2]);
+  Particle currentParticle;
+  currentParticle.weight = 1.0;
+  int cumulated_votes = 0;
+  for (size_t c = 0; c < candidates.size(); ++c) {
+    // Particles [begin, end) of the candidate, so that the counts add up
+    // to the number of particles
+    const PoseCandidate &candidate = candidates[c];
+    int const begin = static_cast<int64_t>(num_particles) *
+                      cumulated_votes / total_votes;
+    cumulated_votes += candidate.votes;
+    int const end = static_cast<int64_t>(num_particles) *
+                    cumulated_votes / total_votes;
+    for (int i = begin; i < end; ++i) {
+      currentParticle.id = i+1;
+      currentParticle.x = candidate.x + noise_x(gen);
+      currentParticle.y = candidate.y + noise_y(gen);
+      currentParticle.theta = remainder(candidate.theta + noise_theta(gen),
+                                        2.0 * M_PI);
+      particles.push_back(currentParticle);
+    }
+  }
+
+  is_initialized = true;
+}
+
 /**
  * prediction Predicts the state for the next time step
  *   using the process model.
@@ -81,62 +139,92 @@ void ParticleFilter::init(double x, double y, double theta, double std[]) {
  */
 void ParticleFilter::prediction(double delta_t, double std_pos[],
                                 double velocity, double yaw_rate) {
-    // Create normal (Gaussians) distribution for x, y, theta given the noises
-    // in input and mean = 0.0
-    normal_distribution<double> dist_p_x(0.0, std_pos[0]);
-    normal_distribution<double> dist_p_y(0.0, std_pos[1]);
-    normal_distribution<double> dist_p_theta(0.0, std_pos[2]);
+    prediction(delta_t, std_pos, velocity, yaw_rate, 0.0);
+}
 
-    // Update particles' position given Bycicle Model
+/**
+ * prediction Predicts the state for the next time step, selecting the
+ *   motion model for the frame: straight line if the yaw rate is negligible,
+ *   CTRV (bicycle model) if the acceleration is 0, CTRA otherwise.
+ * @param delta_t Time between time step t and t+1 in measurements [s]
+ * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+ *   standard deviation of y [m], standard deviation of yaw [rad]]
+ * @param velocity Velocity of car at t [m/s]
+ * @param yaw_rate Yaw rate of car from t to t+1 [rad/s]
+ * @param acceleration Acceleration of car from t to t+1 [m/s^2]
+ */
+void ParticleFilter::prediction(double delta_t, double std_pos[],
+                                double velocity, double yaw_rate,
+                                double acceleration) {
+    ScopedLatency latency(STAGE_PREDICTION);
 
-    // Helper variables
-    Particle currentParticle;
+    moveParticles(delta_t, std_pos, velocity, yaw_rate, acceleration, true);
+}
 
-    double x0 = 0.0;      // Initial x
-    double y0 = 0.0;      // Initial y
-    double theta0 = 0.0;  // Initial theta
-    double xf = 0.0;      // Final x
-    double yf = 0.0;      // Final y
-    double thetaf = 0.0;  // Final theta
+/**
+ * moveParticles Moves all the particles with the motion model of the frame.
+ * @param delta_t Time between time step t and t+1 in measurements [s]
+ * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+ *   standard deviation of y [m], standard deviation of yaw [rad]]
+ * @param velocity Velocity of car at t [m/s]
+ * @param yaw_rate Yaw rate of car from t to t+1 [rad/s]
+ * @param acceleration Acceleration of car from t to t+1 [m/s^2]
+ * @param add_noise False to only apply the motion model (look-ahead)
+ */
+void ParticleFilter::moveParticles(double delta_t, double std_pos[],
+                                   double velocity, double yaw_rate,
+                                   double acceleration, bool add_noise) {
+    if (fabs(yaw_rate) < kStraightYawRate) {
+      predictWith<StraightLineMotion>(
+          StraightLineMotion::step(delta_t, velocity, acceleration), std_pos,
+          add_noise);
+    } else if (acceleration == 0.0) {
+      predictWith<CtrvMotion>(
+          CtrvMotion::step(delta_t, velocity, yaw_rate), std_pos, add_noise);
+    } else {
+      predictWith<CtraMotion>(
+          CtraMotion::step(delta_t, velocity, yaw_rate, acceleration),
+          std_pos, add_noise);
+    }
+}
 
-    // Prevent division by 0
-    if (fabs(yaw_rate) < 0.00001){
-      yaw_rate = 0.00001;
+/**
+ * predictWith Moves all the particles with a motion model, and adds the
+ *   process noise.
+ * @param step Frame-invariant terms of the motion model
+ * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+ *   standard deviation of y [m], standard deviation of yaw [rad]]
+ * @param add_noise False to only apply the motion model
+ */
+template <class Motion>
+void ParticleFilter::predictWith(const MotionStep &step, double std_pos[],
+                                 bool add_noise) {
+    if (!add_noise) {
+      for (int i = 0; i < num_particles; ++i) {
+        Particle &p = particles[i];
+        Motion::apply(step, p.x, p.y, p.theta);
+      }
+      return;
     }
-    double const vOverThetaDot = velocity/yaw_rate;
+
+    // Create normal (Gaussians) distribution for x, y, theta given the noises
+    // in input and mean = 0.0
+    normal_distribution<pf_real> dist_p_x(0.0, std_pos[0]);
+    normal_distribution<pf_real> dist_p_y(0.0, std_pos[1]);
+    normal_distribution<pf_real> dist_p_theta(0.0, std_pos[2]);
 
     // Iterate over particles
     for (int i = 0; i < num_particles; ++i) {
+      Particle &p = particles[i];
 
-      // Extraxt the particle
-      currentParticle = particles[i];
-
-      // Update quantities
-      x0 = currentParticle.x;
-      y0 = currentParticle.y;
-      theta0 = currentParticle.theta;
-
-      // BYCICLE MODEL
-      xf = x0 + vOverThetaDot * (sin(theta0 + (yaw_rate * delta_t)) -
-                  sin(theta0));
-      yf = y0 + vOverThetaDot * (cos(theta0) -
-                  cos(theta0 + (yaw_rate * delta_t)));
-      thetaf = theta0 + (yaw_rate * delta_t);
+      Motion::apply(step, p.x, p.y, p.theta);
 
       // Add noise
       // NOTE: Random noise generator gen defined in particle_filter.h
-      xf += dist_p_x(gen);
-      yf += dist_p_y(gen);
-      thetaf += dist_p_theta(gen);
-
-      // Update particle with new values
-      currentParticle.x = xf;
-      currentParticle.y = yf;
-      currentParticle.theta = thetaf;
-
-      // Re-insert the particle in the vector
-      particles[i] = currentParticle;
-    };
+      p.x += dist_p_x(gen);
+      p.y += dist_p_y(gen);
+      p.theta += dist_p_theta(gen);
+    }
 }
 
 /**
@@ -144,48 +232,102 @@ void ParticleFilter::prediction(double delta_t, double std_pos[],
  *   (likely by using a nearest-neighbors data association).
  *   After identifying the closest landmark to an observation, the id of
  *   the former is passed to the latter.
+ *   If a gate is set (see setAssociationGate), distances are Mahalanobis
+ *   distances and observations with no landmark within the gate are marked
+ *   as outliers, with id = -1. Candidates are rejected as soon as their
+ *   partial distance exceeds the gate or the closest distance found so far.
+ *   In GLOBAL_NEAREST_NEIGHBOR mode, see globalAssociation.
  * @param predicted Vector of predicted landmark observations
  * @param observations Vector of landmark observations
  */
-void ParticleFilter::dataAssociation(vector<LandmarkObs> predicted,
+void ParticleFilter::dataAssociation(const vector<LandmarkObs> &predicted,
                                      vector<LandmarkObs> &observations) {
-    // Helper variables
-    LandmarkObs currentObservation, currentPrediction, closestPrediction;
-    double current_dist;
+    // One-to-one assignment, if requested
+    if (association_mode == GLOBAL_NEAREST_NEIGHBOR) {
+      globalAssociation(predicted, observations);
+      return;
+    }
 
     // Iterate over observed Landmarks
     for (int i = 0; i < observations.size(); ++i) {
 
-      // Extraxt the landmark
-      currentObservation = observations[i];
-
-      // Initialize minum distance and particle index
-      double min_dist = 99999.99;
-      int min_index = 0;
+      int const nearest = measurement.nearest(predicted, observations[i].x,
+                                              observations[i].y);
 
-      // Iterate over predicted Landmarks
-      for (int j = 0; j < predicted.size(); ++j) {
+      // Assign to the observed landmark the id of the closest predicted one,
+      // or mark it as an outlier
+      observations[i].id = nearest < 0 ? -1 : predicted[nearest].id;
+    }
+}
 
-        // Extract the prediction
-        currentPrediction = predicted[j];
+/**
+ * globalAssociation Associates observations and landmarks one-to-one,
+ *   minimizing the total (squared) distance with the Hungarian algorithm.
+ *   Each observation can also be left unassigned (id = -1) at the cost of the
+ *   gate, so no observation is forced onto a landmark outside the gate, and
+ *   only the landmarks within the gate of some observation enter the
+ *   problem. Without a gate, observations are left unassigned only when
+ *   there are more observations than landmarks.
+ * @param predicted Vector of predicted landmark observations
+ * @param observations Vector of landmark observations
+ */
+void ParticleFilter::globalAssociation(const vector<LandmarkObs> &predicted,
+                                       vector<LandmarkObs> &observations) {
+    int const n = observations.size();
+    int const num_predicted = predicted.size();
+    if (n == 0) {
+      return;
+    }
 
-        // Use distance calculator defined in the helper functions
-        current_dist = dist(currentPrediction.x, currentPrediction.y,
-                            currentObservation.x, currentObservation.y);
+    bool const gated = association_gate > 0.0;
+    double const wx = gated ? measurement.inv_var_x : 1.0;
+    double const wy = gated ? measurement.inv_var_y : 1.0;
+
+    // Cost of an unassigned observation, and of a pair outside the gate:
+    // high enough never to be part of the optimal assignment
+    double const unassigned_cost = gated ? association_gate : 1e9;
+    double const forbidden_cost = (n + 1) * unassigned_cost;
+
+    // Distances of all the pairs, and landmarks within the gate of at least
+    // one observation
+    gnn_distances.resize(static_cast<size_t>(n) * num_predicted);
+    gnn_columns.clear();
+    for (int j = 0; j < num_predicted; ++j) {
+      bool in_gate = !gated;
+      for (int i = 0; i < n; ++i) {
+        double const dx = predicted[j].x - observations[i].x;
+        double const dy = predicted[j].y - observations[i].y;
+        double const d = wx * dx * dx + wy * dy * dy;
+        gnn_distances[static_cast<size_t>(i) * num_predicted + j] = d;
+        in_gate = in_gate || d < association_gate;
+      }
+      if (in_gate) {
+        gnn_columns.push_back(j);
+      }
+    }
 
-        // Check distances and update
-        if (current_dist < min_dist ) {
-          min_dist = current_dist;
-          min_index = j;
-        }
+    // Cost matrix: candidate landmarks, then one "unassigned" column per
+    // observation
+    int const m = gnn_columns.size();
+    assignment_solver.resize(n, m + n);
+    for (int i = 0; i < n; ++i) {
+      for (int c = 0; c < m; ++c) {
+        double const d =
+            gnn_distances[static_cast<size_t>(i) * num_predicted +
+                          gnn_columns[c]];
+        assignment_solver.cost(i, c) =
+            (gated && d >= association_gate) ? forbidden_cost : d;
+      }
+      for (int c = m; c < m + n; ++c) {
+        assignment_solver.cost(i, c) = unassigned_cost;
       }
+    }
 
-      // Identify closest landmark
-      closestPrediction = predicted[min_index];
+    assignment_solver.solve(gnn_assignment);
 
-      // Assign to the observed landmark the id of the closest predicted one
-      currentObservation.id = closestPrediction.id;
-      observations[i] = currentObservation;
+    for (int i = 0; i < n; ++i) {
+      int const c = gnn_assignment[i];
+      observations[i].id = c < m ? predicted[gnn_columns[c]].id : -1;
     }
 }
 
@@ -201,66 +343,116 @@ void ParticleFilter::dataAssociation(vector<LandmarkObs> predicted,
 void ParticleFilter::updateWeights(double sensor_range, double std_landmark[],
                                    const vector<LandmarkObs> &observations,
                                    const Map &map_landmarks) {
-    // Helper variables
-    double sigma_x = std_landmark[0];
-    double sigma_y = std_landmark[1];
+    ScopedLatency latency(STAGE_UPDATE_WEIGHTS);
+    SampledStageLaps laps;
 
-    double xp = 0.0;      // Particle x
-    double yp = 0.0;      // Particle y
-    double thetap = 0.0;  // Particle theta
+    // Helper variables
+    pf_real xp = 0.0;      // Particle x
+    pf_real yp = 0.0;      // Particle y
 
     double cumulated_weight = 0.0; // Cumlated weight: will be updated while iterating
                                    // and then used to normalize
 
     vector<LandmarkObs> transformed, predicted;
 
+    // Associations of the previous frame are discarded
+    association_arena.reset();
+
     // Transformation variables
-    LandmarkObs currentObs, transformedObs;
-    double xc = 0.0;  // Landmark x in car ref. frame
-    double yc = 0.0;  // Landmark y in car ref. frame
-    double xm = 0.0;  // Landmark x in map ref. frame
-    double ym = 0.0;  // Landmark y in map ref. frame
+    LandmarkObs transformedObs;
     //
-    // Association variables
-    LandmarkObs currentLandmark;
-    double current_dist;
-    //
-    // Multivariate definition
+    // Multivariate definition (the probabilities in double precision)
     double cumulatedProb = 0.0;
-    double mu_x = 0.0;
-    double mu_y = 0.0;
 
-    double coeff1 = 0.0;
-    double coeff2 = 0.0;
-    double const coeffnorm = 1.0 / (2 * M_PI * sigma_x * sigma_y);
+    // Gaussian of the frame, with the association gate and the likelihood
+    // of the outliers
+    measurement.configure(std_landmark, association_gate, outlier_probability);
+
+    // When the particle cloud is tightly clustered, the map is queried once
+    // for the landmarks in range from any particle, and each particle only
+    // filters this compact candidate set
+    bool const use_candidates = queryFrameCandidates(map_landmarks,
+                                                     sensor_range);
+
+    // With a likelihood floor, the most discriminative observations are
+    // processed first: the farthest ones, the most sensitive to the heading
+    double best_log_prob = -std::numeric_limits<double>::infinity();
+    // (only with the nearest neighbor association, which is per observation)
+    bool const use_floor = likelihood_floor_margin > 0.0 &&
+                           association_mode == NEAREST_NEIGHBOR;
+    if (use_floor) {
+      orderObservations(observations);
+    }
+
+    // Hash table of the particles scored in the frame, at most half full
+    if (deduplicate) {
+      size_t table_size = 16;
+      while (table_size < 2 * static_cast<size_t>(num_particles)) {
+        table_size *= 2;
+      }
+      dedup_table.assign(table_size, -1);
+    }
+    int reused = 0;
 
     // Iterate over particles
     for (int i = 0; i < num_particles; ++i) {
 
+      // Duplicates of a particle already scored share its likelihood
+      if (deduplicate) {
+        int const duplicate = findDuplicate(i);
+        if (duplicate >= 0) {
+          particles[i].weight = particles[duplicate].weight;
+          particles[i].associations = particles[duplicate].associations;
+          cumulated_weight += particles[i].weight;
+          ++reused;
+          continue;
+        }
+      }
+
       xp = particles[i].x;
       yp = particles[i].y;
-      thetap = particles[i].theta;
+
+      laps.begin(i % kLatencySampleStride == 0);
+
+      // With a likelihood floor, observations are transformed, associated and
+      // scored one at a time, and the particle is terminated as soon as it
+      // cannot get above the floor anymore
+      if (use_floor) {
+        collectPredicted(map_landmarks, xp, yp, sensor_range, use_candidates,
+                         predicted);
+        laps.lap(STAGE_RANGE_FILTER);
+
+        uint32_t const first_association = association_arena.mark();
+        double const logProb = scoreWithFloor(particles[i], observations,
+                                              predicted, map_landmarks,
+                                              best_log_prob -
+                                              likelihood_floor_margin, laps);
+        best_log_prob = std::max(best_log_prob, logProb);
+        if (logProb == -std::numeric_limits<double>::infinity()) {
+          association_arena.rollback(first_association);
+        }
+        particles[i].associations =
+            association_arena.spanFrom(first_association);
+
+        particles[i].weight = exp(logProb);
+        cumulated_weight += particles[i].weight;
+        predicted.clear();
+        continue;
+      }
 
       // -----------------------------------------------------------------------
       // STEP 1 - Transform landmark observations from car coordinate frame to
       // map coordinate frame
+      ObservationTransform const transform(xp, yp, particles[i].theta);
       for (int j = 0; j < observations.size(); j++) {
 
-        currentObs = observations[j];
-
-        xc = currentObs.x;
-        yc = currentObs.y;
-
-        xm = xp + (xc * cos(thetap)) - (yc * sin(thetap));
-        ym = yp + (xc * sin(thetap)) + (yc * cos(thetap));
-
-        transformedObs.x = xm;
-        transformedObs.y = ym;
+        transform.apply(observations[j], transformedObs.x, transformedObs.y);
         // NOTE the following id will be modified by the next step (association)
-        transformedObs.id = currentObs.id;
+        transformedObs.id = observations[j].id;
 
         transformed.push_back(transformedObs);
       }
+      laps.lap(STAGE_TRANSFORM);
 
       // -----------------------------------------------------------------------
       // STEP 2 - Associate transformed observations (measurements) with
@@ -268,24 +460,14 @@ void ParticleFilter::updateWeights(double sensor_range, double std_landmark[],
 
       // First create a vector of landmarks predicted within range from the
       // landmark map.
-      // Iterate over landmarks in the map
-      for (int k = 0; k < map_landmarks.landmark_list.size(); k++) {
-
-        currentLandmark.x = map_landmarks.landmark_list[k].x_f;
-        currentLandmark.y = map_landmarks.landmark_list[k].y_f;
-        currentLandmark.id = map_landmarks.landmark_list[k].id_i;
-
-        // check if landmark is in range from the particle, given sensor range
-        current_dist = dist(xp, yp, currentLandmark.x, currentLandmark.y);
-
-        if (current_dist <= sensor_range){
-          predicted.push_back(currentLandmark);
-        }
-      }
+      collectPredicted(map_landmarks, xp, yp, sensor_range, use_candidates,
+                       predicted);
+      laps.lap(STAGE_RANGE_FILTER);
 
       // Second, use data association function to associate predicted and
       // observed landmark
       dataAssociation(predicted,transformed);
+      laps.lap(STAGE_ASSOCIATION);
       // After this the vector of trandformed observation has, for each element,
       // the id of the closest landmark from the list in the map
 
@@ -299,17 +481,34 @@ void ParticleFilter::updateWeights(double sensor_range, double std_landmark[],
       cumulatedProb = 1.0;
 
       for (int l = 0; l < transformed.size(); l++) {
-        // The x and y means are from the nearest landmark, which id is stored
-        // in transformed observation
-        // NOTE: iterators are 0-based while id start from 1
-        mu_x = map_landmarks.landmark_list[transformed[l].id - 1].x_f;
-        mu_y = map_landmarks.landmark_list[transformed[l].id - 1].y_f;
-
-        coeff1 = (pow((transformed[l].x - mu_x),2.0) / (2 * pow(sigma_x,2.0)));
-        coeff2 = (pow((transformed[l].y - mu_y),2.0) / (2 * pow(sigma_y,2.0)));
+        // Observations with no associated landmark score the constant
+        // outlier likelihood
+        if (transformed[l].id < 0) {
+          cumulatedProb *= measurement.outlier;
+          continue;
+        }
 
-        cumulatedProb *= coeffnorm * exp (-(coeff1 + coeff2));
+        // The x and y means are from the nearest landmark, which index in
+        // the landmark list is stored in transformed observation
+        const Map::single_landmark_s &landmark =
+            map_landmarks.landmark_list[transformed[l].id];
+        cumulatedProb *= measurement.score(transformed[l].x - landmark.x_f,
+                                           transformed[l].y - landmark.y_f);
       }
+      laps.lap(STAGE_SCORING);
+
+      // Debugging associations of the particle
+      uint32_t const first_association = association_arena.mark();
+      if (record_associations) {
+        for (size_t l = 0; l < transformed.size(); l++) {
+          if (transformed[l].id >= 0) {
+            association_arena.push(
+                map_landmarks.landmark_list[transformed[l].id].id_i,
+                transformed[l].x, transformed[l].y);
+          }
+        }
+      }
+      particles[i].associations = association_arena.spanFrom(first_association);
 
       // Update particle weight and reassign it
       particles[i].weight = cumulatedProb;
@@ -321,11 +520,276 @@ void ParticleFilter::updateWeights(double sensor_range, double std_landmark[],
       predicted.clear();
       transformed.clear();
     }
+    // Only the evaluated particles are sampled (the reused ones cost nothing)
+    laps.record(num_particles - reused);
+    likelihood_evaluations += num_particles - reused;
+    likelihood_reuses += reused;
+
+    // Kidnap detection, on the unnormalized likelihood of the frame
+    if (recovery != NO_RECOVERY && !lookahead_pass) {
+      kidnap_monitor.update(cumulated_weight / num_particles,
+                            observations.size());
+      recovery_map = &map_landmarks;
+      recovery_observations = observations;
+    }
 
     // After all the previous process, the weights will still have to be normalized
+    normalizeWeights(cumulated_weight);
+}
+
+/**
+ * normalizeWeights Divides the weights by their sum and, if enabled,
+ *   computes the weighted pose estimate in the same pass.
+ * @param cumulated_weight Sum of the weights of the particles
+ */
+void ParticleFilter::normalizeWeights(double cumulated_weight) {
+    // If no particle explains the observations at all (all the likelihoods
+    // underflowed), the weights are left uniform
+    cumulated_weight = uniform_if_degenerate(particles.data(), num_particles,
+                                             cumulated_weight);
+
+    // (the regularized resampling needs the covariance too)
+    if (!estimate_pose && regularization == NO_REGULARIZATION) {
+      for (int i = 0; i < num_particles; ++i) {
+        particles[i].weight = particles[i].weight / cumulated_weight;
+      }
+      return;
+    }
+
+    // When the pose estimate is requested, the weighted moments of the
+    // particle set are accumulated in the same pass of the normalization.
+    // Positions and yaw are taken relative to the first particle, to avoid
+    // cancellation in the covariance and to unwrap the yaw around it.
+    double const x_ref = particles[0].x;
+    double const y_ref = particles[0].y;
+    double const theta_ref = particles[0].theta;
+
+    double sum_x = 0.0, sum_y = 0.0, sum_t = 0.0;    // First order moments
+    double sum_xx = 0.0, sum_yy = 0.0, sum_tt = 0.0; // Second order moments
+    double sum_xy = 0.0, sum_xt = 0.0, sum_yt = 0.0;
+    double sum_sin = 0.0, sum_cos = 0.0;             // Circular mean terms
+
     for (int i = 0; i < num_particles; ++i) {
-      particles[i].weight = particles[i].weight / cumulated_weight;
+      double const w = particles[i].weight / cumulated_weight;
+      particles[i].weight = w;
+
+      double const dx = particles[i].x - x_ref;
+      double const dy = particles[i].y - y_ref;
+      double const dt = remainder(particles[i].theta - theta_ref, 2.0 * M_PI);
+
+      sum_x += w * dx;
+      sum_y += w * dy;
+      sum_t += w * dt;
+      sum_xx += w * dx * dx;
+      sum_yy += w * dy * dy;
+      sum_tt += w * dt * dt;
+      sum_xy += w * dx * dy;
+      sum_xt += w * dx * dt;
+      sum_yt += w * dy * dt;
+      sum_sin += w * sin(particles[i].theta);
+      sum_cos += w * cos(particles[i].theta);
+    }
+
+    pose_estimate.x = x_ref + sum_x;
+    pose_estimate.y = y_ref + sum_y;
+    pose_estimate.theta = atan2(sum_sin, sum_cos);
+
+    pose_estimate.cov[0][0] = sum_xx - sum_x * sum_x;
+    pose_estimate.cov[1][1] = sum_yy - sum_y * sum_y;
+    pose_estimate.cov[2][2] = sum_tt - sum_t * sum_t;
+    pose_estimate.cov[0][1] = pose_estimate.cov[1][0] = sum_xy - sum_x * sum_y;
+    pose_estimate.cov[0][2] = pose_estimate.cov[2][0] = sum_xt - sum_x * sum_t;
+    pose_estimate.cov[1][2] = pose_estimate.cov[2][1] = sum_yt - sum_y * sum_t;
+}
+
+/**
+ * captureAssociations Computes the associations of a single particle, as
+ *   updateWeights does, and stores them for getAssociations and
+ *   getSenseCoord: O(observations) instead of recording the associations of
+ *   every particle.
+ * @param particle Particle whose associations are captured
+ * @param sensor_range Range [m] of sensor
+ * @param observations Vector of landmark observations
+ * @param map_landmarks Map class containing map landmarks
+ */
+void ParticleFilter::captureAssociations(Particle &particle,
+                                         double sensor_range,
+                                         const vector<LandmarkObs> &observations,
+                                         const Map &map_landmarks) {
+    ObservationTransform const transform(particle.x, particle.y,
+                                         particle.theta);
+
+    // Transform to map coordinates
+    vector<LandmarkObs> transformed(observations.size());
+    for (size_t j = 0; j < observations.size(); ++j) {
+      transform.apply(observations[j], transformed[j].x, transformed[j].y);
+      transformed[j].id = observations[j].id;
+    }
+
+    // Associate with the landmarks in range
+    vector<LandmarkObs> predicted;
+    landmarks_in_range(map_landmarks, particle.x, particle.y, sensor_range,
+                       predicted);
+    dataAssociation(predicted, transformed);
+
+    uint32_t const first_association = association_arena.mark();
+    for (size_t j = 0; j < transformed.size(); ++j) {
+      if (transformed[j].id >= 0) {
+        association_arena.push(
+            map_landmarks.landmark_list[transformed[j].id].id_i,
+            transformed[j].x, transformed[j].y);
+      }
+    }
+    particle.associations = association_arena.spanFrom(first_association);
+}
+
+/**
+ * collectPredicted Appends the landmarks within sensor range from a
+ *   particle, from the shared candidates of the frame if available.
+ * @param map_landmarks Map class containing map landmarks
+ * @param (xp,yp) Particle position [m]
+ * @param sensor_range Range [m] of sensor
+ * @param use_candidates True to filter the shared candidates of the frame
+ * @param predicted Vector the landmarks in range are appended to
+ */
+void ParticleFilter::collectPredicted(const Map &map_landmarks, pf_real xp,
+                                      pf_real yp, pf_real sensor_range,
+                                      bool use_candidates,
+                                      vector<LandmarkObs> &predicted) {
+    if (!use_candidates) {
+      landmarks_in_range(map_landmarks, xp, yp, sensor_range, predicted);
+      return;
+    }
+
+    // Only the shared candidates of the frame can be in range
+    for (size_t k = 0; k < frame_candidates.size(); k++) {
+      if (dist(xp, yp, frame_candidates[k].x, frame_candidates[k].y) <=
+          sensor_range) {
+        predicted.push_back(frame_candidates[k]);
+      }
+    }
+}
+
+/**
+ * orderObservations Sorts the observation indices by decreasing range, the
+ *   order in which scoreWithFloor processes them.
+ * @param observations Vector of landmark observations
+ */
+void ParticleFilter::orderObservations(const vector<LandmarkObs> &observations) {
+    observation_order.resize(observations.size());
+    for (size_t j = 0; j < observations.size(); ++j) {
+      observation_order[j] = j;
     }
+    std::sort(observation_order.begin(), observation_order.end(),
+              [&observations](int a, int b) {
+      return observations[a].x * observations[a].x +
+             observations[a].y * observations[a].y >
+             observations[b].x * observations[b].x +
+             observations[b].y * observations[b].y;
+    });
+}
+
+/**
+ * scoreWithFloor Computes the log-likelihood of the observations for a
+ *   particle, transforming, associating and scoring one observation at a
+ *   time. Stops as soon as the partial log-likelihood, plus the best score
+ *   the remaining observations could get, falls below the floor.
+ * @param particle Particle to score
+ * @param observations Vector of landmark observations (vehicle coordinates)
+ * @param predicted Vector of landmarks in range from the particle
+ * @param map_landmarks Map class containing map landmarks
+ * @param floor Floor of the log-likelihood
+ * @param laps Sub-stage timing of the current particle
+ * @output Log-likelihood, or -infinity if the particle was terminated
+ */
+double ParticleFilter::scoreWithFloor(const Particle &particle,
+                                      const vector<LandmarkObs> &observations,
+                                      const vector<LandmarkObs> &predicted,
+                                      const Map &map_landmarks, double floor,
+                                      SampledStageLaps &laps) {
+    ObservationTransform const transform(particle.x, particle.y,
+                                         particle.theta);
+
+    // Best score of an observation
+    double const log_outlier = log(measurement.outlier);
+    double const max_term = std::max(measurement.log_norm, log_outlier);
+
+    double logProb = 0.0;
+    int const n = observation_order.size();
+
+    for (int k = 0; k < n; ++k) {
+      const LandmarkObs &obs = observations[observation_order[k]];
+
+      // Transform to map coordinates
+      pf_real xm, ym;
+      transform.apply(obs, xm, ym);
+      laps.lap(STAGE_TRANSFORM);
+
+      // Associate
+      int const nearest = measurement.nearest(predicted, xm, ym);
+      laps.lap(STAGE_ASSOCIATION);
+
+      // Score
+      if (nearest < 0) {
+        logProb += log_outlier;
+      } else {
+        const Map::single_landmark_s &landmark =
+            map_landmarks.landmark_list[predicted[nearest].id];
+        pf_real const dx = xm - landmark.x_f;
+        pf_real const dy = ym - landmark.y_f;
+        logProb += measurement.logScore(dx, dy);
+        if (record_associations) {
+          association_arena.push(landmark.id_i, xm, ym);
+        }
+      }
+      laps.lap(STAGE_SCORING);
+
+      // Terminate if the floor cannot be reached anymore
+      int const remaining = n - k - 1;
+      if (logProb + remaining * max_term < floor) {
+        skipped_observations += remaining;
+        ++terminated_particles;
+        return -std::numeric_limits<double>::infinity();
+      }
+    }
+    return logProb;
+}
+
+/**
+ * queryFrameCandidates Computes the bounding box of the particle cloud and,
+ *   if the cloud is tight enough, collects the landmarks within sensor range
+ *   from any particle in it (within sensor range plus the cloud radius from
+ *   the center of the box).
+ * @param map_landmarks Map class containing map landmarks
+ * @param sensor_range Range [m] of sensor
+ * @output True if the candidates have been collected, false if the cloud
+ *   is too dispersed and landmarks have to be queried per particle
+ */
+bool ParticleFilter::queryFrameCandidates(const Map &map_landmarks,
+                                          double sensor_range) {
+    frame_candidates.clear();
+    if (max_cloud_radius <= 0.0 || num_particles == 0) {
+      return false;
+    }
+
+    pf_real min_x = particles[0].x, max_x = particles[0].x;
+    pf_real min_y = particles[0].y, max_y = particles[0].y;
+    for (int i = 1; i < num_particles; ++i) {
+      min_x = std::min(min_x, particles[i].x);
+      max_x = std::max(max_x, particles[i].x);
+      min_y = std::min(min_y, particles[i].y);
+      max_y = std::max(max_y, particles[i].y);
+    }
+
+    double const cloud_radius = 0.5 * dist(min_x, min_y, max_x, max_y);
+    if (cloud_radius > max_cloud_radius) {
+      return false;
+    }
+
+    landmarks_in_range(map_landmarks, 0.5 * (min_x + max_x),
+                       0.5 * (min_y + max_y), sensor_range + cloud_radius,
+                       frame_candidates);
+    return true;
 }
 
 /**
@@ -334,6 +798,8 @@ void ParticleFilter::updateWeights(double sensor_range, double std_landmark[],
  *   Applies SAMPLING WHEEL resampling algorithm
  */
 void ParticleFilter::resample() {
+   ScopedLatency latency(STAGE_RESAMPLE);
+
    // Determine maximum weight for current particles
    double highest_weight = -1.0;
    for (int i = 0; i < num_particles; ++i) {
@@ -343,11 +809,12 @@ void ParticleFilter::resample() {
    }
 
    // Uniform distributions for index and beta
-   uniform_int_distribution<int> dist_index(1, num_particles);
+   uniform_int_distribution<int> dist_index(0, num_particles - 1);
    uniform_real_distribution<double> dist_beta(0.0, 2.0 * highest_weight);
 
-   // Initialize new vector and coefficient beta
-   std::vector<Particle> resampledParticles;
+   // Initialize vector of sampled indices and coefficient beta
+   vector<int> &sampled = resample_indices;
+   sampled.resize(num_particles);
    double beta = 0.0;
 
    // Get starting index randomly
@@ -367,17 +834,451 @@ void ParticleFilter::resample() {
        index = (index + 1) % num_particles;
      }
 
-     // Push sample particle in the new vector
-     resampledParticles.push_back(particles[index]);
+     // Store the index of the sampled particle
+     sampled[j] = index;
+   }
+
+   // Optionally sort the samples along a Morton (Z-order) curve, so that
+   // particles close in memory are close in space too
+   if (spatial_ordering) {
+     sortSpatially(sampled);
+   }
+
+   // Gather the sampled particles in the new vector
+   std::vector<Particle> resampledParticles;
+   resampledParticles.reserve(num_particles);
+   if (regularization == NO_REGULARIZATION) {
+     for (int j = 0; j < num_particles; ++j) {
+       resampledParticles.push_back(particles[sampled[j]]);
+     }
+   } else {
+     // Regularized: every sample is jittered with the kernel as it is
+     // gathered, counting the duplicates of particles already drawn
+     double transform[3][3];
+     jitterTransform(transform);
+     drawn.assign(num_particles, 0);
+
+     for (int j = 0; j < num_particles; ++j) {
+       const Particle &ancestor = particles[sampled[j]];
+       resampledParticles.push_back(ancestor);
+       Particle &p = resampledParticles.back();
+
+       double e[3];
+       drawKernel(e);
+       p.x += transform[0][0] * e[0];
+       p.y += transform[1][0] * e[0] + transform[1][1] * e[1];
+       p.theta += transform[2][0] * e[0] + transform[2][1] * e[1] +
+                  transform[2][2] * e[2];
+
+       if (drawn[sampled[j]]) {
+         ++resampled_duplicates;
+         if (p.x != ancestor.x || p.y != ancestor.y ||
+             p.theta != ancestor.theta) {
+           ++separated_duplicates;
+         }
+       }
+       drawn[sampled[j]] = 1;
+     }
+   }
+
+   // Kidnap recovery: some of the particles are replaced by recovery poses
+   // while the observations are explained worse than usual
+   if (recovery != NO_RECOVERY) {
+     injectRecoveryPoses(resampledParticles);
    }
 
    // Re-assign the vector of particles
-   particles.clear();
-   particles = resampledParticles;
+   particles.swap(resampledParticles);
+}
+
+/**
+ * auxiliaryUpdate Runs a frame of the auxiliary particle filter (Pitt and
+ *   Shephard): the look-ahead stage scores the noiseless predicted pose of
+ *   every particle, and particles are resampled by their weight times this
+ *   likelihood before being moved, so that the samples are spent on the
+ *   parents that agree with the new observations. The final weights are the
+ *   likelihoods divided by the look-ahead likelihood of the parent.
+ *   Both stages run the prediction, updateWeights and resample kernels.
+ * @param delta_t Time between time step t and t+1 in measurements [s]
+ * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+ *   standard deviation of y [m], standard deviation of yaw [rad]]
+ * @param velocity Velocity of car from t to t+1 [m/s]
+ * @param yaw_rate Yaw rate of car from t to t+1 [rad/s]
+ * @param sensor_range Range [m] of sensor
+ * @param std_landmark[] Array of dimension 2
+ *   [Landmark measurement uncertainty [x [m], y [m]]]
+ * @param observations Vector of landmark observations at t+1
+ * @param map_landmarks Map class containing map landmarks
+ */
+void ParticleFilter::auxiliaryUpdate(double delta_t, double std_pos[],
+                                     double velocity, double yaw_rate,
+                                     double sensor_range,
+                                     double std_landmark[],
+                                     const vector<LandmarkObs> &observations,
+                                     const Map &map_landmarks) {
+    // The pose estimate is only computed on the final weights
+    bool const estimate = estimate_pose;
+    estimate_pose = false;
+
+    // The resample of stage 2 injects recovery poses before this frame's
+    // updateWeights: it must use this frame's map, the one of the previous
+    // frame may have been released since
+    recovery_map = &map_landmarks;
+
+    // -------------------------------------------------------------------------
+    // STAGE 1 - Look-ahead: likelihood of the noiseless predicted poses (not
+    // tracked by the kidnap detection)
+    aux_parents = particles;
+    moveParticles(delta_t, std_pos, velocity, yaw_rate, 0.0, false);
+
+    // The noiseless pose ignores the process noise: the measurement
+    // uncertainty is widened by the position noise, and by the yaw noise at
+    // half the sensor range, so that the look-ahead does not overcommit to a
+    // few parents
+    double const lever = 0.5 * sensor_range;
+    double lookahead_std[2];
+    for (int k = 0; k < 2; ++k) {
+      lookahead_std[k] = sqrt(std_landmark[k] * std_landmark[k] +
+                              std_pos[k] * std_pos[k] +
+                              lever * lever * std_pos[2] * std_pos[2]);
+    }
+    lookahead_pass = true;
+    updateWeights(sensor_range, lookahead_std, observations, map_landmarks);
+    lookahead_pass = false;
+
+    // First stage weights: weight of the parent times look-ahead likelihood
+    aux_lookahead.resize(num_particles);
+    double first_stage_weight = 0.0;
+    for (int i = 0; i < num_particles; ++i) {
+      aux_lookahead[i] = particles[i].weight;
+      particles[i] = aux_parents[i];
+      particles[i].weight *= aux_lookahead[i];
+      first_stage_weight += particles[i].weight;
+    }
+
+    // If no parent explains the observations, fall back to plain sampling
+    if (!(first_stage_weight > 0.0) || std::isinf(first_stage_weight)) {
+      for (int i = 0; i < num_particles; ++i) {
+        particles[i].weight = aux_parents[i].weight;
+        aux_lookahead[i] = 1.0;
+      }
+    }
+
+    // -------------------------------------------------------------------------
+    // STAGE 2 - Resample the parents, then move and weight the children
+    resample();
+    prediction(delta_t, std_pos, velocity, yaw_rate);
+    updateWeights(sensor_range, std_landmark, observations, map_landmarks);
+
+    // Second stage weights: the parent (resample_indices, in the order of
+    // the children) was drawn proportionally to its look-ahead likelihood.
+    // Recovery poses (index -1) were not, and get the mean look-ahead.
+    double mean_lookahead = 0.0;
+    for (int i = 0; i < num_particles; ++i) {
+      mean_lookahead += aux_lookahead[i] / num_particles;
+    }
+    double cumulated_weight = 0.0;
+    for (int j = 0; j < num_particles; ++j) {
+      double const lookahead = resample_indices[j] >= 0 ?
+                               aux_lookahead[resample_indices[j]] :
+                               mean_lookahead;
+      particles[j].weight = lookahead > 0.0 ?
+                            particles[j].weight / lookahead : 0.0;
+      cumulated_weight += particles[j].weight;
+    }
+
+    estimate_pose = estimate;
+    normalizeWeights(cumulated_weight);
+}
+
+/**
+ * injectRecoveryPoses Replaces each resampled particle by a recovery pose
+ *   with the injection probability of the kidnap monitor. The number of
+ *   replaced particles is drawn first, so tracking frames (probability 0)
+ *   cost nothing. The sampled index of a replaced particle is set to -1.
+ * @param resampled Resampled particles, in the order of resample_indices
+ */
+void ParticleFilter::injectRecoveryPoses(vector<Particle> &resampled) {
+    double const probability = kidnap_monitor.injectionProbability();
+    if (!(probability > 0.0) || recovery_map == NULL ||
+        recovery_map->landmark_list.empty()) {
+      return;
+    }
+
+    std::binomial_distribution<int> dist_count(num_particles,
+                                               std::min(probability, 1.0));
+    uniform_int_distribution<int> dist_index(0, num_particles - 1);
+    int const count = dist_count(gen);
+    for (int k = 0; k < count; ++k) {
+      int const j = dist_index(gen);
+      drawRecoveryPose(resampled[j]);
+      // Not the associations of the particle it replaces
+      resampled[j].associations = AssociationSpan();
+      resample_indices[j] = -1;
+    }
+    injected_particles += count;
+}
+
+/**
+ * drawRecoveryPose Draws a recovery pose. Uniform: position uniform over
+ *   the bounding box of the landmarks, uniform heading. Map guided: a random
+ *   observation is matched to a random landmark, and a second observation
+ *   to one of the landmarks at the same distance from the first one (found
+ *   with the grid index), which sets the heading; falls back to a uniform
+ *   heading around the first landmark if there is no such landmark.
+ * @param particle Particle whose pose is replaced
+ */
+void ParticleFilter::drawRecoveryPose(Particle &particle) {
+    const Map &map = *recovery_map;
+    const vector<LandmarkObs> &observations = recovery_observations;
+    uniform_real_distribution<double> dist_unit(0.0, 1.0);
+    uniform_real_distribution<double> dist_theta(-M_PI, M_PI);
+
+    if (recovery == UNIFORM_RECOVERY || observations.empty()) {
+      float min_x, min_y, max_x, max_y;
+      if (map.hasIndex()) {
+        map.indexBounds(min_x, min_y, max_x, max_y);
+      } else {
+        min_x = max_x = map.landmark_list[0].x_f;
+        min_y = max_y = map.landmark_list[0].y_f;
+        for (size_t k = 1; k < map.landmark_list.size(); ++k) {
+          min_x = std::min(min_x, map.landmark_list[k].x_f);
+          max_x = std::max(max_x, map.landmark_list[k].x_f);
+          min_y = std::min(min_y, map.landmark_list[k].y_f);
+          max_y = std::max(max_y, map.landmark_list[k].y_f);
+        }
+      }
+      particle.x = min_x + dist_unit(gen) * (max_x - min_x);
+      particle.y = min_y + dist_unit(gen) * (max_y - min_y);
+      particle.theta = dist_theta(gen);
+      return;
+    }
+
+    uniform_int_distribution<int> dist_obs(0, observations.size() - 1);
+    uniform_int_distribution<int> dist_landmark(0,
+                                                map.landmark_list.size() - 1);
+    const LandmarkObs &first = observations[dist_obs(gen)];
+    const Map::single_landmark_s &anchor =
+        map.landmark_list[dist_landmark(gen)];
+
+    // Heading from a second observation and a landmark at the same distance
+    // from the anchor (within the measurement noise of both observations)
+    double theta = dist_theta(gen);
+    const LandmarkObs &second = observations[dist_obs(gen)];
+    double const dx_obs = second.x - first.x;
+    double const dy_obs = second.y - first.y;
+    double const separation = sqrt(dx_obs * dx_obs + dy_obs * dy_obs);
+    double const min_inv_var = std::min(measurement.inv_var_x,
+                                        measurement.inv_var_y);
+    double const tolerance = 3.0 * sqrt(2.0 / min_inv_var);
+    if (separation > tolerance && map.hasIndex()) {
+      recovery_candidates.clear();
+      vector<int> &candidates = recovery_candidates;
+      map.forEachInRange(anchor.x_f, anchor.y_f, separation + tolerance,
+          [&](const Map::cell_landmark_s &landmark) {
+        double const d = dist(anchor.x_f, anchor.y_f, landmark.x_f,
+                              landmark.y_f);
+        if (fabs(d - separation) <= tolerance) {
+          candidates.push_back(landmark.index);
+        }
+      });
+      if (!candidates.empty()) {
+        uniform_int_distribution<int> dist_candidate(0, candidates.size() - 1);
+        const Map::single_landmark_s &match =
+            map.landmark_list[candidates[dist_candidate(gen)]];
+        theta = atan2(match.y_f - anchor.y_f, match.x_f - anchor.x_f) -
+                atan2(dy_obs, dx_obs);
+      }
+    }
+
+    // Position that puts the anchor at the first observation
+    double const cos_theta = cos(theta);
+    double const sin_theta = sin(theta);
+    particle.x = anchor.x_f - (first.x * cos_theta - first.y * sin_theta);
+    particle.y = anchor.y_f - (first.x * sin_theta + first.y * cos_theta);
+    particle.theta = remainder(theta, 2.0 * M_PI);
+}
+
+/**
+ * dedupKey Computes the deduplication key of a particle: its state
+ *   quantized by the epsilons, or the bits of its state.
+ * @param particle Particle
+ * @param key Key
+ */
+void ParticleFilter::dedupKey(const Particle &particle, int64_t key[3]) const {
+    if (dedup_position_epsilon > 0.0) {
+      key[0] = llround(particle.x / dedup_position_epsilon);
+      key[1] = llround(particle.y / dedup_position_epsilon);
+      key[2] = dedup_yaw_epsilon > 0.0 ?
+               llround(particle.theta / dedup_yaw_epsilon) : 0;
+      return;
+    }
+    double const state[3] = {particle.x, particle.y, particle.theta};
+    memcpy(key, state, sizeof(state));
+}
+
+/**
+ * findDuplicate Looks the key of a particle up in the hash table of the
+ *   frame (open addressing, linear probing).
+ * @param index Index of the particle
+ * @output Index of a particle scored in the frame with the same key, or -1
+ *   if there is none (the particle is then added to the table)
+ */
+int ParticleFilter::findDuplicate(int index) {
+    int64_t key[3];
+    dedupKey(particles[index], key);
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (int k = 0; k < 3; ++k) {
+      hash = (hash ^ static_cast<uint64_t>(key[k])) * 1099511628211ULL;
+      hash ^= hash >> 29;
+    }
+
+    size_t const mask = dedup_table.size() - 1;
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+      int const other = dedup_table[slot];
+      if (other < 0) {
+        dedup_table[slot] = index;
+        return -1;
+      }
+      int64_t other_key[3];
+      dedupKey(particles[other], other_key);
+      if (other_key[0] == key[0] && other_key[1] == key[1] &&
+          other_key[2] == key[2]) {
+        return other;
+      }
+    }
+}
+
+/**
+ * jitterTransform Computes the lower triangular transform applied to the
+ *   kernel samples: the Cholesky factor of the weighted covariance of the
+ *   particles (from the last updateWeights), times the optimal bandwidth of
+ *   the kernel for a gaussian posterior in 3 dimensions (Musso, Oudjane and
+ *   Le Gland), times the bandwidth scale. Directions with no spread are not
+ *   jittered.
+ * @param transform Lower triangular transform
+ */
+void ParticleFilter::jitterTransform(double transform[3][3]) const {
+    double const n = std::max(num_particles, 1);
+    double bandwidth;
+    if (regularization == GAUSSIAN_KERNEL) {
+      // (4 / (n (d + 2)))^(1 / (d + 4))
+      bandwidth = pow(4.0 / (5.0 * n), 1.0 / 7.0);
+    } else {
+      // (8 / c_d (d + 4) (2 sqrt(pi))^d / n)^(1 / (d + 4)), with c_d the
+      // volume of the unit sphere
+      double const c_d = 4.0 / 3.0 * M_PI;
+      bandwidth = pow(8.0 / c_d * 7.0 * pow(2.0 * sqrt(M_PI), 3.0) / n,
+                      1.0 / 7.0);
+    }
+    bandwidth *= bandwidth_scale;
+
+    const double (&cov)[3][3] = pose_estimate.cov;
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) {
+        transform[r][c] = 0.0;
+      }
+    }
+    for (int c = 0; c < 3; ++c) {
+      double pivot = cov[c][c];
+      for (int k = 0; k < c; ++k) {
+        pivot -= transform[c][k] * transform[c][k];
+      }
+      if (!(pivot > 0.0)) {
+        continue;
+      }
+      transform[c][c] = sqrt(pivot);
+      for (int r = c + 1; r < 3; ++r) {
+        double sum = cov[r][c];
+        for (int k = 0; k < c; ++k) {
+          sum -= transform[r][k] * transform[c][k];
+        }
+        transform[r][c] = sum / transform[c][c];
+      }
+    }
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c <= r; ++c) {
+        transform[r][c] *= bandwidth;
+      }
+    }
+}
+
+/**
+ * drawKernel Draws a sample of the regularization kernel: standard normal,
+ *   or Epanechnikov on the unit ball (uniform direction, with the squared
+ *   radius drawn from a Beta(3/2, 2) distribution).
+ * @param sample Sample
+ */
+void ParticleFilter::drawKernel(double sample[3]) {
+    normal_distribution<double> normal(0.0, 1.0);
+    sample[0] = normal(gen);
+    sample[1] = normal(gen);
+    sample[2] = normal(gen);
+    if (regularization == GAUSSIAN_KERNEL) {
+      return;
+    }
+
+    std::gamma_distribution<double> gamma_a(1.5, 1.0);
+    std::gamma_distribution<double> gamma_b(2.0, 1.0);
+    double const a = gamma_a(gen);
+    double const b = gamma_b(gen);
+    double const norm = sqrt(sample[0] * sample[0] + sample[1] * sample[1] +
+                             sample[2] * sample[2]);
+    double const scale = norm > 0.0 ? sqrt(a / (a + b)) / norm : 0.0;
+    sample[0] *= scale;
+    sample[1] *= scale;
+    sample[2] *= scale;
+}
+
+/**
+ * Interleaves the bits of two 16 bit values into a 32 bit Morton code.
+ */
+static uint32_t mortonCode(uint32_t x, uint32_t y) {
+  x = (x | (x << 8)) & 0x00FF00FF;
+  x = (x | (x << 4)) & 0x0F0F0F0F;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+  y = (y | (y << 8)) & 0x00FF00FF;
+  y = (y | (y << 4)) & 0x0F0F0F0F;
+  y = (y | (y << 2)) & 0x33333333;
+  y = (y | (y << 1)) & 0x55555555;
+  return x | (y << 1);
+}
+
+/**
+ * sortSpatially Sorts particle indices by the Morton code of the position
+ *   of the particles, quantized over the bounding box of the particle set.
+ * @param indices Indices in the current particle vector
+ */
+void ParticleFilter::sortSpatially(vector<int> &indices) {
+  pf_real min_x = particles[0].x, max_x = particles[0].x;
+  pf_real min_y = particles[0].y, max_y = particles[0].y;
+  for (int i = 1; i < num_particles; ++i) {
+    min_x = std::min(min_x, particles[i].x);
+    max_x = std::max(max_x, particles[i].x);
+    min_y = std::min(min_y, particles[i].y);
+    max_y = std::max(max_y, particles[i].y);
+  }
+  double const scale = 65535.0 / std::max<double>(std::max(max_x - min_x,
+                                                           max_y - min_y),
+                                                  1e-9);
+
+  // Codes are computed once per source particle, then the indices are sorted
+  morton_codes.resize(num_particles);
+  for (int i = 0; i < num_particles; ++i) {
+    uint32_t const qx = static_cast<uint32_t>((particles[i].x - min_x) * scale);
+    uint32_t const qy = static_cast<uint32_t>((particles[i].y - min_y) * scale);
+    morton_codes[i] = mortonCode(qx, qy);
+  }
+  const vector<uint32_t> &codes = morton_codes;
+  std::sort(indices.begin(), indices.end(), [&codes](int a, int b) {
+    return codes[a] < codes[b];
+  });
 }
 
 void ParticleFilter::SetAssociations(Particle& particle,
-                                     const vector<int>& associations,
+                                     const vector<int64_t>& associations,
                                      const vector<double>& sense_x,
                                      const vector<double>& sense_y) {
   // particle: the particle to which assign each listed association,
@@ -385,31 +1286,33 @@ void ParticleFilter::SetAssociations(Particle& particle,
   // associations: The landmark id that goes along with each listed association
   // sense_x: the associations x mapping already converted to world coordinates
   // sense_y: the associations y mapping already converted to world coordinates
-  particle.associations= associations;
-  particle.sense_x = sense_x;
-  particle.sense_y = sense_y;
+  uint32_t const first = association_arena.mark();
+  for (size_t i = 0; i < associations.size(); ++i) {
+    association_arena.push(associations[i], sense_x[i], sense_y[i]);
+  }
+  particle.associations = association_arena.spanFrom(first);
 }
 
-string ParticleFilter::getAssociations(Particle best) {
-  vector<int> v = best.associations;
+string ParticleFilter::getAssociations(const Particle &best) {
+  const association_s *records = associationRecords(best);
   std::stringstream ss;
-  copy(v.begin(), v.end(), std::ostream_iterator<int>(ss, " "));
+  for (uint32_t i = 0; records != NULL && i < best.associations.count; ++i) {
+    ss << records[i].id << " ";
+  }
   string s = ss.str();
   s = s.substr(0, s.length()-1);  // get rid of the trailing space
   return s;
 }
 
-string ParticleFilter::getSenseCoord(Particle best, string coord) {
-  vector<double> v;
-
-  if (coord == "X") {
-    v = best.sense_x;
-  } else {
-    v = best.sense_y;
-  }
+string ParticleFilter::getSenseCoord(const Particle &best, string coord) {
+  const association_s *records = associationRecords(best);
+  bool const x = coord == "X";
 
   std::stringstream ss;
-  copy(v.begin(), v.end(), std::ostream_iterator<float>(ss, " "));
+  for (uint32_t i = 0; records != NULL && i < best.associations.count; ++i) {
+    ss << static_cast<float>(x ? records[i].sense_x : records[i].sense_y)
+       << " ";
+  }
   string s = ss.str();
   s = s.substr(0, s.length()-1);  // get rid of the trailing space
   return s;
@@ -12,20 +12,66 @@
 #ifndef PARTICLE_FILTER_H_
 #define PARTICLE_FILTER_H_
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <random>
+#include "assignment.h"
+#include "association_arena.h"
 #include "helper_functions.h"
+#include "kidnap_monitor.h"
+#include "measurement_models.h"
+#include "motion_models.h"
+#include "pose_voting.h"
+
+class SampledStageLaps;
+
+/**
+ * Data association engines.
+ */
+enum AssociationMode {
+  NEAREST_NEIGHBOR,         // Each observation to its nearest landmark
+  GLOBAL_NEAREST_NEIGHBOR   // One-to-one, minimum total distance
+};
+
+/**
+ * Kernels of the regularized resampling.
+ */
+enum RegularizationKernel {
+  NO_REGULARIZATION,    // Exact copies of the sampled particles
+  GAUSSIAN_KERNEL,      // Gaussian jitter
+  EPANECHNIKOV_KERNEL   // Epanechnikov jitter, within a bounded ellipsoid
+};
+
+/**
+ * Poses injected by the kidnap recovery.
+ */
+enum RecoveryMode {
+  NO_RECOVERY,          // No kidnap recovery
+  UNIFORM_RECOVERY,     // Uniform over the map, uniform heading
+  MAP_GUIDED_RECOVERY   // Poses matching two observations to two landmarks
+};
 
 struct Particle {
   int id;
-  double x;
-  double y;
-  double theta;
-  double weight;
-  std::vector<int> associations;
-  std::vector<double> sense_x;
-  std::vector<double> sense_y;
+  pf_real x;
+  pf_real y;
+  pf_real theta;
+  double weight;  // Double even in single precision: products of many
+                  //   likelihoods underflow a float
+  AssociationSpan associations;  // Debugging associations, in the arena of
+                                 //   the filter (valid for the frame)
+};
+
+/**
+ * Struct representing the weighted estimate of the vehicle pose computed
+ *   over the whole particle set.
+ */
+struct PoseEstimate {
+  double x;          // Weighted mean x position [m]
+  double y;          // Weighted mean y position [m]
+  double theta;      // Weighted circular mean of the yaw [rad]
+  double cov[3][3];  // Weighted covariance of (x, y, theta)
 };
 
 
@@ -33,7 +79,22 @@ class ParticleFilter {
  public:
   // Constructor
   // @param num_particles Number of particles
-  ParticleFilter() : num_particles(0), is_initialized(false) {}
+  ParticleFilter() : num_particles(0), configured_particles(1000),
+                     is_initialized(false),
+                     estimate_pose(false), pose_estimate(),
+                     spatial_ordering(false), max_cloud_radius(0.0),
+                     association_gate(0.0), outlier_probability(0.0),
+                     likelihood_floor_margin(0.0), skipped_observations(0),
+                     terminated_particles(0),
+                     association_mode(NEAREST_NEIGHBOR),
+                     record_associations(false),
+                     regularization(NO_REGULARIZATION), bandwidth_scale(1.0),
+                     resampled_duplicates(0), separated_duplicates(0),
+                     deduplicate(false), dedup_position_epsilon(0.0),
+                     dedup_yaw_epsilon(0.0), likelihood_evaluations(0),
+                     likelihood_reuses(0), recovery(NO_RECOVERY),
+                     recovery_map(NULL), lookahead_pass(false),
+                     injected_particles(0) {}
 
   // Destructor
   ~ParticleFilter() {}
@@ -49,6 +110,18 @@ class ParticleFilter {
    */
   void init(double x, double y, double theta, double std[]);
 
+  /**
+   * initFromCandidates Initializes particle filter without a prior, from
+   *   the candidate poses voted by the observations (see PoseVoter): the
+   *   particles are shared among the candidates in proportion to their
+   *   votes, and drawn from a Gaussian distribution around them.
+   * @param candidates Candidate poses (at least one)
+   * @param std[] Array of dimension 3 [standard deviation of x [m],
+   *   standard deviation of y [m], standard deviation of yaw [rad]]
+   */
+  void initFromCandidates(const std::vector<PoseCandidate> &candidates,
+                          double std[]);
+
   /**
    * prediction Predicts the state for the next time step
    *   using the process model.
@@ -61,13 +134,27 @@ class ParticleFilter {
   void prediction(double delta_t, double std_pos[], double velocity,
                   double yaw_rate);
 
+  /**
+   * prediction Predicts the state for the next time step of an accelerating
+   *   vehicle (CTRA model, or straight line with negligible yaw rate).
+   * @param delta_t Time between time step t and t+1 in measurements [s]
+   * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+   *   standard deviation of y [m], standard deviation of yaw [rad]]
+   * @param velocity Velocity of car at t [m/s]
+   * @param yaw_rate Yaw rate of car from t to t+1 [rad/s]
+   * @param acceleration Acceleration of car from t to t+1 [m/s^2]
+   */
+  void prediction(double delta_t, double std_pos[], double velocity,
+                  double yaw_rate, double acceleration);
+
   /**
    * dataAssociation Finds which observations correspond to which landmarks
    *   (likely by using a nearest-neighbors data association).
+   *   Observations outside the association gate get id = -1.
    * @param predicted Vector of predicted landmark observations
    * @param observations Vector of landmark observations
    */
-  void dataAssociation(std::vector<LandmarkObs> predicted,
+  void dataAssociation(const std::vector<LandmarkObs> &predicted,
                        std::vector<LandmarkObs>& observations);
 
   /**
@@ -89,16 +176,59 @@ class ParticleFilter {
    */
   void resample();
 
+  /**
+   * auxiliaryUpdate Runs a frame of the auxiliary particle filter, in place
+   *   of prediction, updateWeights and resample: the particles are first
+   *   resampled by their weight times the likelihood of their noiseless
+   *   predicted pose (look-ahead), then moved and weighted, and the weights
+   *   are corrected by the look-ahead likelihood of their parent.
+   *   Resampling happens at the start of the frame, so resample must not be
+   *   called between two auxiliary frames (or after init).
+   * @param delta_t Time between time step t and t+1 in measurements [s]
+   * @param std_pos[] Array of dimension 3 [standard deviation of x [m],
+   *   standard deviation of y [m], standard deviation of yaw [rad]]
+   * @param velocity Velocity of car from t to t+1 [m/s]
+   * @param yaw_rate Yaw rate of car from t to t+1 [rad/s]
+   * @param sensor_range Range [m] of sensor
+   * @param std_landmark[] Array of dimension 2
+   *   [Landmark measurement uncertainty [x [m], y [m]]]
+   * @param observations Vector of landmark observations at t+1
+   * @param map_landmarks Map class containing map landmarks
+   */
+  void auxiliaryUpdate(double delta_t, double std_pos[], double velocity,
+                       double yaw_rate, double sensor_range,
+                       double std_landmark[],
+                       const std::vector<LandmarkObs> &observations,
+                       const Map &map_landmarks);
+
   /**
    * Set a particles list of associations, along with the associations'
    *   calculated world x,y coordinates
    * This can be a very useful debugging tool to make sure transformations
    *   are correct and assocations correctly connected
+   * The associations are stored in the arena of the filter, and are valid
+   *   until the next call to updateWeights.
    */
-  void SetAssociations(Particle& particle, const std::vector<int>& associations,
+  void SetAssociations(Particle& particle,
+                       const std::vector<int64_t>& associations,
                        const std::vector<double>& sense_x,
                        const std::vector<double>& sense_y);
 
+  /**
+   * captureAssociations Computes the associations of a single particle, as
+   *   updateWeights does, and stores them for getAssociations and
+   *   getSenseCoord. Used to report the best particle without recording the
+   *   associations of every particle. Must be called after updateWeights,
+   *   with the same observations and map.
+   * @param particle Particle whose associations are captured
+   * @param sensor_range Range [m] of sensor
+   * @param observations Vector of landmark observations
+   * @param map_landmarks Map class containing map landmarks
+   */
+  void captureAssociations(Particle &particle, double sensor_range,
+                           const std::vector<LandmarkObs> &observations,
+                           const Map &map_landmarks);
+
   /**
    * initialized Returns whether particle filter is initialized yet or not.
    */
@@ -106,11 +236,228 @@ class ParticleFilter {
     return is_initialized;
   }
 
+  /**
+   * setPoseEstimation Enables or disables the computation of the weighted
+   *   pose estimate, fused into the weight normalization of updateWeights.
+   * @param enabled True to compute the estimate at every update
+   */
+  void setPoseEstimation(bool enabled) {
+    estimate_pose = enabled;
+  }
+
+  /**
+   * poseEstimate Returns the weighted pose estimate computed by the last
+   *   call to updateWeights (only meaningful if pose estimation is enabled).
+   */
+  const PoseEstimate& poseEstimate() const {
+    return pose_estimate;
+  }
+
+  /**
+   * setSpatialOrdering Enables or disables the reordering of the particles
+   *   along a Morton curve during resample, so that consecutive particles
+   *   query the same map region in updateWeights. Disabled by default:
+   *   it only pays back when the map lookups dominate the frame.
+   * @param enabled True to reorder the particles at every resample
+   */
+  void setSpatialOrdering(bool enabled) {
+    spatial_ordering = enabled;
+  }
+
+  /**
+   * setSharedCandidates Sets the maximum radius of the particle cloud for
+   *   which updateWeights queries the map once per frame, and shares the
+   *   resulting candidate landmarks among all the particles.
+   * @param max_radius Maximum cloud radius [m], 0 to always query the map
+   *   per particle
+   */
+  void setSharedCandidates(double max_radius) {
+    max_cloud_radius = max_radius;
+  }
+
+  /**
+   * setAssociationGate Sets the chi-square gate of the data association:
+   *   observations whose squared Mahalanobis distance (with the landmark
+   *   measurement uncertainty) from every landmark exceeds the gate are
+   *   treated as outliers.
+   * @param chi2_gate Gate on the squared Mahalanobis distance (e.g. 9.21 for
+   *   the 99% of a 2 DOF chi-square), 0 to disable gating
+   * @param outlier_prob Likelihood assigned to an outlier observation, 0 to
+   *   score it at the measurement density on the gate boundary (an outlier
+   *   never scores more than an associated observation)
+   */
+  void setAssociationGate(double chi2_gate, double outlier_prob) {
+    association_gate = chi2_gate;
+    outlier_probability = outlier_prob;
+  }
+
+  /**
+   * setAssociationMode Selects the data association engine. The global
+   *   nearest neighbor engine enforces a one-to-one assignment between
+   *   observations and landmarks (observations left out are outliers).
+   * @param mode Association engine
+   */
+  void setAssociationMode(AssociationMode mode) {
+    association_mode = mode;
+  }
+
+  /**
+   * setLikelihoodFloor Enables the early termination of the particles in
+   *   updateWeights: a particle is dropped (weight 0) as soon as its partial
+   *   log-likelihood cannot get within the margin of the best particle
+   *   scored so far in the frame. Observations are processed farthest first.
+   *   Only used with the NEAREST_NEIGHBOR association mode.
+   * @param log_margin Margin [nats] below the best log-likelihood, 0 to
+   *   disable the early termination
+   */
+  void setLikelihoodFloor(double log_margin) {
+    likelihood_floor_margin = log_margin;
+  }
+
+  /**
+   * setAssociationRecording Enables or disables the recording of the
+   *   associations of every particle in updateWeights (see getAssociations).
+   *   Disabled by default: see captureAssociations to get the associations of
+   *   the reported particle only.
+   * @param enabled True to record the associations
+   */
+  void setAssociationRecording(bool enabled) {
+    record_associations = enabled;
+  }
+
+  /**
+   * setRegularization Enables the regularized resampling: resample jitters
+   *   the sampled particles with a kernel shaped by the weighted covariance
+   *   of the particle set (see poseEstimate, computed by updateWeights
+   *   whenever the regularization is enabled), so that copies of the same
+   *   particle become distinct hypotheses.
+   * @param kernel Jitter kernel, NO_REGULARIZATION to disable
+   * @param bandwidth Scale of the optimal kernel bandwidth for a gaussian
+   *   posterior (1 = optimal)
+   */
+  void setRegularization(RegularizationKernel kernel, double bandwidth) {
+    regularization = kernel;
+    bandwidth_scale = bandwidth;
+  }
+
+  /**
+   * resampledDuplicates, separatedDuplicates Return the number of particles
+   *   drawn by resample that were copies of an already drawn particle, and
+   *   how many of them the regularization moved away from their ancestor,
+   *   since the filter was created (only counted with regularization).
+   */
+  uint64_t resampledDuplicates() const {
+    return resampled_duplicates;
+  }
+  uint64_t separatedDuplicates() const {
+    return separated_duplicates;
+  }
+
+  /**
+   * setDeduplication Enables the deduplicated likelihood evaluation in
+   *   updateWeights: particles with the same state share the likelihood of
+   *   the first of them scored in the frame (and its associations).
+   * @param enabled True to deduplicate
+   * @param position_epsilon Quantization step of x and y [m], 0 to only
+   *   share between bit-identical particles
+   * @param yaw_epsilon Quantization step of the yaw [rad] (used when
+   *   position_epsilon > 0)
+   */
+  void setDeduplication(bool enabled, double position_epsilon,
+                        double yaw_epsilon) {
+    deduplicate = enabled;
+    dedup_position_epsilon = position_epsilon;
+    dedup_yaw_epsilon = yaw_epsilon;
+  }
+
+  /**
+   * likelihoodEvaluations, likelihoodReuses Return the number of particles
+   *   scored by updateWeights, and of particles which reused the likelihood
+   *   of a duplicate instead, since the filter was created.
+   */
+  uint64_t likelihoodEvaluations() const {
+    return likelihood_evaluations;
+  }
+  uint64_t likelihoodReuses() const {
+    return likelihood_reuses;
+  }
+
+  /**
+   * setRecovery Enables the kidnap recovery of Augmented MCL: updateWeights
+   *   tracks short and long term averages of the particle likelihood (see
+   *   KidnapMonitor), and resample replaces each particle by a recovery pose
+   *   with probability max(0, 1 - short / long term average). Recovery poses
+   *   are drawn from the map and the observations of the last
+   *   updateWeights, so resample must be called while that map is valid
+   *   (auxiliaryUpdate draws them from the map it is given).
+   * @param mode Recovery poses, NO_RECOVERY to disable
+   * @param alpha_slow Decay rate of the long term average (e.g. 0.001)
+   * @param alpha_fast Decay rate of the short term average (e.g. 0.1)
+   */
+  void setRecovery(RecoveryMode mode, double alpha_slow, double alpha_fast) {
+    recovery = mode;
+    kidnap_monitor.configure(alpha_slow, alpha_fast);
+  }
+
+  /**
+   * injectionProbability Returns the current probability of replacing a
+   *   particle by a recovery pose (0 while tracking).
+   */
+  double injectionProbability() const {
+    return recovery == NO_RECOVERY ? 0.0 :
+           kidnap_monitor.injectionProbability();
+  }
+
+  /**
+   * injectedParticles Returns the number of recovery poses injected since
+   *   the filter was created.
+   */
+  uint64_t injectedParticles() const {
+    return injected_particles;
+  }
+
+  /**
+   * setNumParticles Sets the number of particles created by init.
+   * @param count Number of particles (1000 by default)
+   */
+  void setNumParticles(int count) {
+    configured_particles = count;
+  }
+
+  /**
+   * seed Seeds the random engine of the filter, for reproducible runs.
+   * @param value Seed
+   */
+  void seed(unsigned int value) {
+    gen.seed(value);
+  }
+
+  /**
+   * skippedObservations, terminatedParticles Return the number of
+   *   observations skipped, and particles terminated, by the likelihood floor
+   *   since the filter was created.
+   */
+  uint64_t skippedObservations() const {
+    return skipped_observations;
+  }
+  uint64_t terminatedParticles() const {
+    return terminated_particles;
+  }
+
   /**
    * Used for obtaining debugging information related to particles.
    */
-  std::string getAssociations(Particle best);
-  std::string getSenseCoord(Particle best, std::string coord);
+  std::string getAssociations(const Particle &best);
+  std::string getSenseCoord(const Particle &best, std::string coord);
+
+  /**
+   * associationRecords Returns the debugging associations of a particle
+   *   (particle.associations.count records), or NULL if it has none in the
+   *   current frame. Valid until the next call to updateWeights.
+   */
+  const association_s *associationRecords(const Particle &particle) const {
+    return association_arena.recordsOf(particle.associations);
+  }
 
   // Set of current particles
   std::vector<Particle> particles;
@@ -119,14 +466,186 @@ class ParticleFilter {
   // Number of particles to draw
   int num_particles;
 
+  // Number of particles created by init
+  int configured_particles;
+
   // Flag, if filter is initialized
   bool is_initialized;
 
   // Vector of weights of all particles
   std::vector<double> weights;
 
+  // Flag, if the weighted pose estimate has to be computed
+  bool estimate_pose;
+
+  // Weighted pose estimate from the last update
+  PoseEstimate pose_estimate;
+
+  // Flag, if particles are sorted along a Morton curve when resampled
+  bool spatial_ordering;
+
+  // Buffers reused by resample: sampled indices and their Morton codes
+  std::vector<int> resample_indices;
+  std::vector<uint32_t> morton_codes;
+
+  // Maximum particle cloud radius for the shared candidate landmarks [m]
+  double max_cloud_radius;
+
+  // Candidate landmarks of the current frame
+  std::vector<LandmarkObs> frame_candidates;
+
+  // Association gate on the squared Mahalanobis distance (0 = disabled),
+  // configured likelihood of the outliers, and measurement model of the
+  // frame built from them by updateWeights
+  double association_gate;
+  double outlier_probability;
+  GaussianLikelihood measurement;
+
+  // Early termination margin [nats] (0 = disabled), its counters and the
+  // order in which the observations are scored
+  double likelihood_floor_margin;
+  uint64_t skipped_observations;
+  uint64_t terminated_particles;
+  std::vector<int> observation_order;
+
+  // Association engine, and buffers reused by the global nearest neighbor
+  AssociationMode association_mode;
+
+  // Debugging associations of the particles, reset at every update
+  bool record_associations;
+  AssociationArena association_arena;
+  AssignmentSolver assignment_solver;
+  std::vector<double> gnn_distances;
+  std::vector<int> gnn_columns;
+  std::vector<int> gnn_assignment;
+
+  // Regularized resampling kernel, bandwidth scale, duplicate counters and
+  // buffer of the particles already drawn in the frame
+  RegularizationKernel regularization;
+  double bandwidth_scale;
+  uint64_t resampled_duplicates;
+  uint64_t separated_duplicates;
+  std::vector<char> drawn;
+
+  // Deduplicated likelihood evaluation: quantization steps (0 = bit
+  // identical), counters, and hash table of the particles scored in the
+  // frame (indices, -1 = empty)
+  bool deduplicate;
+  double dedup_position_epsilon;
+  double dedup_yaw_epsilon;
+  uint64_t likelihood_evaluations;
+  uint64_t likelihood_reuses;
+  std::vector<int> dedup_table;
+
+  // Kidnap recovery: poses, likelihood averages, map and observations of the
+  // last update, flag of the look-ahead pass of the auxiliary filter (not
+  // tracked), counter and buffer of the landmarks matching an observation
+  RecoveryMode recovery;
+  KidnapMonitor kidnap_monitor;
+  const Map *recovery_map;
+  std::vector<LandmarkObs> recovery_observations;
+  bool lookahead_pass;
+  uint64_t injected_particles;
+  std::vector<int> recovery_candidates;
+
+  // Buffers reused by auxiliaryUpdate: particles of the previous frame and
+  // look-ahead likelihood of each of them
+  std::vector<Particle> aux_parents;
+  std::vector<double> aux_lookahead;
+
   // Random engine for generating pdf
   std::default_random_engine gen;
+
+  /**
+   * moveParticles Moves all the particles with the motion model of the
+   *   frame, with or without process noise.
+   */
+  void moveParticles(double delta_t, double std_pos[], double velocity,
+                     double yaw_rate, double acceleration, bool add_noise);
+
+  /**
+   * predictWith Moves all the particles with a motion model.
+   */
+  template <class Motion>
+  void predictWith(const MotionStep &step, double std_pos[], bool add_noise);
+
+  /**
+   * normalizeWeights Normalizes the weights, computing the pose estimate if
+   *   enabled.
+   */
+  void normalizeWeights(double cumulated_weight);
+
+  /**
+   * globalAssociation Associates observations and landmarks one-to-one.
+   */
+  void globalAssociation(const std::vector<LandmarkObs> &predicted,
+                         std::vector<LandmarkObs> &observations);
+
+  /**
+   * collectPredicted Appends the landmarks within sensor range from a
+   *   particle.
+   */
+  void collectPredicted(const Map &map_landmarks, pf_real xp, pf_real yp,
+                        pf_real sensor_range, bool use_candidates,
+                        std::vector<LandmarkObs> &predicted);
+
+  /**
+   * orderObservations Sorts the observations by decreasing range.
+   */
+  void orderObservations(const std::vector<LandmarkObs> &observations);
+
+  /**
+   * scoreWithFloor Computes the log-likelihood of a particle, terminating
+   *   early below the floor.
+   */
+  double scoreWithFloor(const Particle &particle,
+                        const std::vector<LandmarkObs> &observations,
+                        const std::vector<LandmarkObs> &predicted,
+                        const Map &map_landmarks, double floor,
+                        SampledStageLaps &laps);
+
+  /**
+   * queryFrameCandidates Collects the landmarks in range from the particle
+   *   cloud, if it is clustered enough.
+   */
+  bool queryFrameCandidates(const Map &map_landmarks, double sensor_range);
+
+  /**
+   * dedupKey Computes the deduplication key of a particle.
+   */
+  void dedupKey(const Particle &particle, int64_t key[3]) const;
+
+  /**
+   * findDuplicate Returns a particle scored in the frame with the same key,
+   *   or registers the particle and returns -1.
+   */
+  int findDuplicate(int index);
+
+  /**
+   * injectRecoveryPoses Replaces resampled particles by recovery poses.
+   */
+  void injectRecoveryPoses(std::vector<Particle> &resampled);
+
+  /**
+   * drawRecoveryPose Draws a recovery pose.
+   */
+  void drawRecoveryPose(Particle &particle);
+
+  /**
+   * jitterTransform Computes the transform of the kernel samples: bandwidth
+   *   times the Cholesky factor of the particle covariance.
+   */
+  void jitterTransform(double transform[3][3]) const;
+
+  /**
+   * drawKernel Draws a sample of the regularization kernel.
+   */
+  void drawKernel(double sample[3]);
+
+  /**
+   * sortSpatially Sorts particle indices along a Morton curve.
+   */
+  void sortSpatially(std::vector<int> &indices);
 };
 
 #endif  // PARTICLE_FILTER_H_
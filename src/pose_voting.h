@@ -0,0 +1,509 @@
+/**
+ * pose_voting.h
+ * Global localization from a single set of observations, without a GPS
+ * prior, by geometric hashing of the landmark pairs of the map.
+ *
+ * The distance between two landmarks does not depend on the pose of the
+ * vehicle, so every pair of landmarks of the map closer than twice the
+ * sensor range is indexed by its distance (once per map). At query time an
+ * anchor observation is paired with each other observation, and every map
+ * pair of the same length (in both directions) tells which landmark the
+ * anchor would be, and the heading of the vehicle. These hypotheses vote in
+ * a dense (landmark, heading) table: the right one collects a vote per
+ * partner observation, the coincidental ones are scattered. The winners are
+ * refined by a least squares fit of the observations to the landmarks they
+ * then fall on.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef POSE_VOTING_H_
+#define POSE_VOTING_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "helper_functions.h"
+#include "map.h"
+
+/**
+ * Vehicle pose voted by the observations.
+ */
+struct PoseCandidate {
+  double x;      // x position [m]
+  double y;      // y position [m]
+  double theta;  // Heading [rad]
+  int votes;     // Observation pairs agreeing on the pose
+  int matched;   // Observations within tolerance of a landmark at the pose
+};
+
+class PoseVoter {
+ public:
+  // Heading cells of the vote (a power of two)
+  static const int kYawCells = 64;
+
+  PoseVoter() : map(NULL), max_separation(0.0), tolerance(0.0),
+                min_separation(0.0), yaw_cell(2.0 * M_PI / kYawCells),
+                max_observation_pairs(16) {}
+
+  /**
+   * build Indexes the landmark pairs of a map by their distance. Uses the
+   *   grid index of the map if it has been built. Must be called again if
+   *   the map changes, which must outlive the voter.
+   * @param map_landmarks Map
+   * @param max_distance Longest pair indexed [m] (twice the sensor range)
+   * @param distance_tolerance Largest difference between the separation of
+   *   two observations and the distance of the landmarks they match [m]
+   * @output False (and the index left empty) if the distance or the
+   *   tolerance is not positive
+   */
+  bool build(const Map &map_landmarks, double max_distance,
+             double distance_tolerance) {
+    pairs.clear();
+    if (!(max_distance > 0.0) || !(distance_tolerance > 0.0)) {
+      map = NULL;
+      return false;
+    }
+
+    map = &map_landmarks;
+    max_separation = max_distance;
+    tolerance = distance_tolerance;
+    // Shorter observation pairs determine the heading too poorly
+    min_separation = 4.0 * tolerance;
+
+    // Landmarks numbered in stripes of the maximum distance, along x in each
+    // stripe: the two landmarks of a pair get close numbers, and the pairs
+    // of a distance bin, in order of their first landmark, vote for nearby
+    // cells of the table in turn instead of all over it
+    const std::vector<Map::single_landmark_s> &landmarks = map->landmark_list;
+    spatialOrder(landmarks, max_distance);
+
+    // Pairs (first < second) within the maximum distance
+    for (size_t i = 0; i < order.size(); ++i) {
+      int const first = static_cast<int>(i);
+      const Map::single_landmark_s &landmark = landmarks[order[i]];
+      if (map->hasIndex()) {
+        map->forEachInRange(landmark.x_f, landmark.y_f, max_distance,
+            [&](const Map::cell_landmark_s &other) {
+          if (rank[other.index] > first) {
+            addPair(first, rank[other.index]);
+          }
+        });
+      } else {
+        for (size_t k = i + 1; k < order.size(); ++k) {
+          addPair(first, static_cast<int>(k));
+        }
+      }
+    }
+    rank.clear();
+
+    // Counting sort of the pairs by distance bin (one tolerance wide)
+    int const num_bins = static_cast<int>(max_distance / tolerance) + 1;
+    bin_start.assign(num_bins + 1, 0);
+    for (size_t p = 0; p < pairs.size(); ++p) {
+      ++bin_start[binOf(pairs[p].distance) + 1];
+    }
+    for (size_t b = 1; b < bin_start.size(); ++b) {
+      bin_start[b] += bin_start[b - 1];
+    }
+    // (stable: the pairs of a bin stay in order of their first landmark)
+    std::vector<int> fill(bin_start.begin(), bin_start.end() - 1);
+    std::vector<pair_s> sorted(pairs.size());
+    for (size_t p = 0; p < pairs.size(); ++p) {
+      sorted[fill[binOf(pairs[p].distance)]++] = pairs[p];
+    }
+    pairs.swap(sorted);
+
+    counts.assign(landmarks.size() * kYawCells, 0);
+    return true;
+  }
+
+  /**
+   * setObservationPairs Sets the maximum number of observation pairs voting
+   *   (16 by default, at most 64), which bounds the cost of a vote. Each
+   *   anchor is paired with up to half of them, so that two anchors vote
+   *   at least.
+   */
+  void setObservationPairs(int count) {
+    max_observation_pairs = std::min(count, 64);
+  }
+
+  /**
+   * empty Returns whether the index has no pair (not built, or no two
+   *   landmarks close enough).
+   */
+  bool empty() const {
+    return pairs.empty();
+  }
+
+  /**
+   * pairCount Returns the number of landmark pairs indexed.
+   */
+  size_t pairCount() const {
+    return pairs.size();
+  }
+
+  /**
+   * candidateSpread Returns the standard deviations of the error of the
+   *   candidate poses, to spread the particles seeded around them.
+   * @param std[] Array of dimension 3 [x [m], y [m], yaw [rad]]
+   */
+  void candidateSpread(double std[]) const {
+    std[0] = 0.5 * tolerance;
+    std[1] = 0.5 * tolerance;
+    std[2] = tolerance / max_separation;
+  }
+
+  /**
+   * vote Finds the vehicle poses most consistent with a set of observations.
+   *   Poses voted by a single observation pair are not reported.
+   * @param observations Observations, in vehicle coordinates
+   * @param max_candidates Maximum number of poses returned
+   * @param candidates Poses, by decreasing number of observations matched,
+   *   then of votes (cleared)
+   * @output Number of poses found
+   */
+  int vote(const std::vector<LandmarkObs> &observations, int max_candidates,
+           std::vector<PoseCandidate> &candidates) {
+    candidates.clear();
+    if (pairs.empty()) {
+      return 0;
+    }
+
+    // Anchors in turn, each paired with its nearest observations, until the
+    // budget of observation pairs runs out (a spurious anchor spoils its
+    // own votes only)
+    int const n = observations.size();
+    int const partners = std::min(n - 1, max_observation_pairs / 2);
+    if (partners < 1) {
+      return 0;
+    }
+    int const anchors = std::min(n, max_observation_pairs / partners);
+    for (int anchor = 0; anchor < anchors; ++anchor) {
+      voteAnchor(observations, anchor, partners, max_candidates, candidates);
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const PoseCandidate &a, const PoseCandidate &b) {
+      return a.matched > b.matched ||
+             (a.matched == b.matched && a.votes > b.votes);
+    });
+    if (static_cast<int>(candidates.size()) > max_candidates) {
+      candidates.resize(max_candidates);
+    }
+    return candidates.size();
+  }
+
+ private:
+  // Landmark pair: distance, and direction from the first to the second
+  // landmark [heading cells]
+  struct pair_s {
+    float distance;
+    float heading;
+    int first;
+    int second;
+  };
+
+  /**
+   * spatialOrder Numbers the landmarks by stripe of a given height, then by
+   *   x: order maps the numbers to the landmarks, rank the reverse.
+   */
+  void spatialOrder(const std::vector<Map::single_landmark_s> &landmarks,
+                    double stripe) {
+    std::vector<std::pair<std::pair<double, float>, int> > keys;
+    keys.reserve(landmarks.size());
+    for (size_t i = 0; i < landmarks.size(); ++i) {
+      keys.push_back(std::make_pair(
+          std::make_pair(floor(landmarks[i].y_f / stripe), landmarks[i].x_f),
+          static_cast<int>(i)));
+    }
+    std::sort(keys.begin(), keys.end());
+    order.resize(landmarks.size());
+    rank.resize(landmarks.size());
+    for (size_t r = 0; r < keys.size(); ++r) {
+      order[r] = keys[r].second;
+      rank[keys[r].second] = static_cast<int>(r);
+    }
+  }
+
+  void addPair(int first, int second) {
+    const Map::single_landmark_s &a = map->landmark_list[order[first]];
+    const Map::single_landmark_s &b = map->landmark_list[order[second]];
+    float const dx = b.x_f - a.x_f;
+    float const dy = b.y_f - a.y_f;
+    float const distance = sqrt(dx * dx + dy * dy);
+    if (distance > max_separation || distance == 0.0f) {
+      return;
+    }
+    pair_s pair;
+    pair.distance = distance;
+    pair.heading = atan2(dy, dx) / yaw_cell;
+    pair.first = first;
+    pair.second = second;
+    pairs.push_back(pair);
+  }
+
+  int binOf(double distance) const {
+    return std::min(static_cast<int>(distance / tolerance),
+                    static_cast<int>(bin_start.size()) - 2);
+  }
+
+  /**
+   * voteAnchor Votes the (landmark, heading) of an anchor observation with
+   *   its nearest partner observations, and adds the refined winners to the
+   *   candidates (merging the poses already found from another anchor).
+   *   The number of map pairs matching an observation pair grows with its
+   *   separation, so the nearest partners (still far enough to fix the
+   *   heading) are the cheapest ones.
+   */
+  void voteAnchor(const std::vector<LandmarkObs> &observations, int anchor,
+                  int partners, int max_candidates,
+                  std::vector<PoseCandidate> &candidates) {
+    const LandmarkObs &a = observations[anchor];
+    nearest.clear();
+    for (size_t b = 0; b < observations.size(); ++b) {
+      double const dx = observations[b].x - a.x;
+      double const dy = observations[b].y - a.y;
+      double const separation = sqrt(dx * dx + dy * dy);
+      if (separation >= min_separation &&
+          separation <= max_separation + tolerance) {
+        nearest.push_back(std::make_pair(separation, static_cast<int>(b)));
+      }
+    }
+    int const count = std::min<int>(partners, nearest.size());
+    std::partial_sort(nearest.begin(), nearest.begin() + count,
+                      nearest.end());
+
+    promoted.clear();
+    for (int k = 0; k < count; ++k) {
+      const LandmarkObs &b = observations[nearest[k].second];
+      double const separation = nearest[k].first;
+      double const dx = b.x - a.x;
+      double const dy = b.y - a.y;
+      // Heading cell of a pair: floor(pair heading - offset), with the
+      // offset making the argument positive
+      float const offset = atan2(dy, dx) / yaw_cell - 1.5f * kYawCells;
+      int const first = bin_start[binOf(std::max(0.0, separation - tolerance))];
+      int const last = bin_start[binOf(separation + tolerance) + 1];
+      for (int p = first; p < last; ++p) {
+        const pair_s &pair = pairs[p];
+        if (fabs(pair.distance - separation) > tolerance) {
+          continue;
+        }
+        // Anchor on the first landmark, or on the second one (reversed)
+        int const ct = static_cast<int>(pair.heading - offset) &
+                       (kYawCells - 1);
+        addVote(pair.first * kYawCells + ct);
+        addVote(pair.second * kYawCells +
+                ((ct + kYawCells / 2) & (kYawCells - 1)));
+      }
+    }
+
+    // Cells by decreasing votes with their heading neighbors, taken from a
+    // heap: only the first few are refined, out of thousands promoted
+    ranked.clear();
+    for (size_t k = 0; k < promoted.size(); ++k) {
+      int const cell = promoted[k];
+      ranked.push_back(std::make_pair(neighborhood(cell), cell));
+    }
+    auto const after = [](const std::pair<int, int> &x,
+                          const std::pair<int, int> &y) {
+      return x.first < y.first || (x.first == y.first && x.second > y.second);
+    };
+    std::make_heap(ranked.begin(), ranked.end(), after);
+
+    int accepted = 0;
+    while (!ranked.empty() && accepted < max_candidates) {
+      std::pop_heap(ranked.begin(), ranked.end(), after);
+      std::pair<int, int> const best = ranked.back();
+      ranked.pop_back();
+      int const landmark = order[best.second / kYawCells];
+      int const ct = best.second % kYawCells;
+      PoseCandidate candidate;
+      candidate.votes = best.first;
+      candidate.theta = -M_PI + (ct + 0.5) * yaw_cell;
+      placeAnchor(a, landmark, candidate);
+      refine(observations, candidate);
+      // Neighbor cells of the same anchor often refine to the same pose
+      if (candidate.matched < 2 || findPose(candidate, anchor_found) >= 0) {
+        continue;
+      }
+      anchor_found.push_back(candidate);
+      ++accepted;
+    }
+
+    // Poses found from another anchor add up their votes
+    for (size_t k = 0; k < anchor_found.size(); ++k) {
+      int const same = findPose(anchor_found[k], candidates);
+      if (same >= 0) {
+        candidates[same].votes += anchor_found[k].votes;
+      } else {
+        candidates.push_back(anchor_found[k]);
+      }
+    }
+    anchor_found.clear();
+
+    memset(counts.data(), 0, counts.size());
+  }
+
+  void addVote(int cell) {
+    // Counts stay below 256: a cell gets a few votes per partner at most
+    if (++counts[cell] == 2) {
+      promoted.push_back(cell);
+    }
+  }
+
+  /**
+   * neighborhood Returns the votes of a cell and of its heading neighbors.
+   */
+  int neighborhood(int cell) const {
+    int const base = cell & ~(kYawCells - 1);
+    int const ct = cell & (kYawCells - 1);
+    return counts[cell] +
+           counts[base + ((ct + 1) & (kYawCells - 1))] +
+           counts[base + ((ct - 1) & (kYawCells - 1))];
+  }
+
+  /**
+   * placeAnchor Sets the position of a candidate so that the anchor
+   *   observation falls on a landmark, given its heading.
+   */
+  void placeAnchor(const LandmarkObs &anchor, int landmark,
+                   PoseCandidate &candidate) const {
+    const Map::single_landmark_s &l = map->landmark_list[landmark];
+    double const cos_theta = cos(candidate.theta);
+    double const sin_theta = sin(candidate.theta);
+    candidate.x = l.x_f - (cos_theta * anchor.x - sin_theta * anchor.y);
+    candidate.y = l.y_f - (sin_theta * anchor.x + cos_theta * anchor.y);
+  }
+
+  /**
+   * refine Fits the pose of a candidate to the observations falling near a
+   *   landmark (least squares rigid transform), twice: the gate of the
+   *   first fit allows for the heading quantization.
+   */
+  void refine(const std::vector<LandmarkObs> &observations,
+              PoseCandidate &candidate) const {
+    for (int iteration = 0; iteration < 2; ++iteration) {
+      double const cos_theta = cos(candidate.theta);
+      double const sin_theta = sin(candidate.theta);
+      double sum_o[2] = {0.0, 0.0};
+      double sum_l[2] = {0.0, 0.0};
+      double dot = 0.0;
+      double cross = 0.0;
+      int matched = 0;
+      for (size_t k = 0; k < observations.size(); ++k) {
+        const LandmarkObs &o = observations[k];
+        double const range = sqrt(o.x * o.x + o.y * o.y);
+        double const gate = tolerance +
+                            (iteration == 0 ? range * yaw_cell : 0.0);
+        double const x = candidate.x + cos_theta * o.x - sin_theta * o.y;
+        double const y = candidate.y + sin_theta * o.x + cos_theta * o.y;
+        int const landmark = nearestLandmark(x, y, gate);
+        if (landmark < 0) {
+          continue;
+        }
+        const Map::single_landmark_s &l = map->landmark_list[landmark];
+        sum_o[0] += o.x;
+        sum_o[1] += o.y;
+        sum_l[0] += l.x_f;
+        sum_l[1] += l.y_f;
+        // Accumulated uncentered, centered below
+        dot += o.x * l.x_f + o.y * l.y_f;
+        cross += o.x * l.y_f - o.y * l.x_f;
+        ++matched;
+      }
+      candidate.matched = matched;
+      if (matched < 2) {
+        return;
+      }
+      double const c[2] = {sum_o[0] / matched, sum_o[1] / matched};
+      double const m[2] = {sum_l[0] / matched, sum_l[1] / matched};
+      dot -= matched * (c[0] * m[0] + c[1] * m[1]);
+      cross -= matched * (c[0] * m[1] - c[1] * m[0]);
+      candidate.theta = atan2(cross, dot);
+      double const cos_fit = cos(candidate.theta);
+      double const sin_fit = sin(candidate.theta);
+      candidate.x = m[0] - (cos_fit * c[0] - sin_fit * c[1]);
+      candidate.y = m[1] - (sin_fit * c[0] + cos_fit * c[1]);
+    }
+  }
+
+  /**
+   * nearestLandmark Returns the landmark closest to a position within a
+   *   radius, or -1.
+   */
+  int nearestLandmark(double x, double y, double radius) const {
+    int nearest = -1;
+    double best = radius * radius;
+    if (map->hasIndex()) {
+      map->forEachInRange(x, y, radius,
+          [&](const Map::cell_landmark_s &landmark) {
+        double const d2 = (landmark.x_f - x) * (landmark.x_f - x) +
+                          (landmark.y_f - y) * (landmark.y_f - y);
+        if (d2 <= best) {
+          best = d2;
+          nearest = landmark.index;
+        }
+      });
+      return nearest;
+    }
+    for (size_t k = 0; k < map->landmark_list.size(); ++k) {
+      const Map::single_landmark_s &landmark = map->landmark_list[k];
+      double const d2 = (landmark.x_f - x) * (landmark.x_f - x) +
+                        (landmark.y_f - y) * (landmark.y_f - y);
+      if (d2 <= best) {
+        best = d2;
+        nearest = static_cast<int>(k);
+      }
+    }
+    return nearest;
+  }
+
+  /**
+   * findPose Returns the index of a candidate with the same pose, or -1.
+   */
+  int findPose(const PoseCandidate &candidate,
+               const std::vector<PoseCandidate> &others) const {
+    for (size_t k = 0; k < others.size(); ++k) {
+      const PoseCandidate &other = others[k];
+      if (fabs(other.x - candidate.x) <= tolerance &&
+          fabs(other.y - candidate.y) <= tolerance &&
+          fabs(remainder(other.theta - candidate.theta, 2.0 * M_PI)) <=
+          yaw_cell) {
+        return static_cast<int>(k);
+      }
+    }
+    return -1;
+  }
+
+  const Map *map;
+  double max_separation;
+  double tolerance;
+  double min_separation;
+  double yaw_cell;
+  int max_observation_pairs;
+
+  // Landmarks by number (the landmarks of the pairs and of the table are
+  // numbers), and numbers of the landmarks (while building)
+  std::vector<int> order;
+  std::vector<int> rank;
+
+  // Landmark pairs in distance bin order, and first pair of each bin
+  std::vector<pair_s> pairs;
+  std::vector<int> bin_start;
+
+  // Partners of the current anchor by separation, its votes per (landmark,
+  // heading cell), cells with two votes or more, the latter ranked, and the
+  // poses found
+  std::vector<std::pair<double, int> > nearest;
+  std::vector<uint8_t> counts;
+  std::vector<int> promoted;
+  std::vector<std::pair<int, int> > ranked;
+  std::vector<PoseCandidate> anchor_found;
+};
+
+#endif  // POSE_VOTING_H_
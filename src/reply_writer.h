@@ -0,0 +1,243 @@
+/**
+ * reply_writer.h
+ * Serializer of the replies to the simulator, writing the JSON text directly
+ * into a reusable buffer (one per connection): no json object, no
+ * temporary strings, and no allocation once the buffer has grown to the
+ * size of a reply.
+ *
+ * Numbers are written with 10 significant digits by integer arithmetic,
+ * without going through the locale-dependent printf machinery.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef REPLY_WRITER_H_
+#define REPLY_WRITER_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <string>
+
+class ReplyWriter {
+ public:
+  static const int kSignificantDigits = 10;
+
+  ReplyWriter() {
+    buffer.reserve(4096);
+  }
+
+  /**
+   * begin Starts a socket.io event message: 42["<event>",{
+   */
+  void begin(const char *event) {
+    buffer.clear();
+    buffer.append("42[\"");
+    buffer.append(event);
+    buffer.append("\",{");
+    first_field = true;
+  }
+
+  /**
+   * end Closes the message.
+   */
+  void end() {
+    buffer.append("}]");
+  }
+
+  /**
+   * field Writes a numeric field.
+   */
+  void field(const char *key, double value) {
+    writeKey(key);
+    writeNumber(value);
+  }
+
+  /**
+   * field Writes an array of numbers field.
+   */
+  void field(const char *key, const double *values, int count) {
+    writeKey(key);
+    buffer.push_back('[');
+    for (int i = 0; i < count; ++i) {
+      if (i > 0) {
+        buffer.push_back(',');
+      }
+      writeNumber(values[i]);
+    }
+    buffer.push_back(']');
+  }
+
+  /**
+   * beginList, item, endList Write a string field holding a space
+   *   separated list of numbers, the format of the debugging fields.
+   */
+  void beginList(const char *key) {
+    writeKey(key);
+    buffer.push_back('"');
+    first_item = true;
+  }
+  void item(int64_t value) {
+    separateItem();
+    writeInteger(value);
+  }
+  void item(double value) {
+    separateItem();
+    writeNumber(value);
+  }
+  void endList() {
+    buffer.push_back('"');
+  }
+
+  const char *data() const {
+    return buffer.data();
+  }
+
+  size_t size() const {
+    return buffer.size();
+  }
+
+ private:
+  void writeKey(const char *key) {
+    if (!first_field) {
+      buffer.push_back(',');
+    }
+    first_field = false;
+    buffer.push_back('"');
+    buffer.append(key);
+    buffer.append("\":");
+  }
+
+  void separateItem() {
+    if (!first_item) {
+      buffer.push_back(' ');
+    }
+    first_item = false;
+  }
+
+  void writeInteger(int64_t value) {
+    uint64_t magnitude = static_cast<uint64_t>(value);
+    if (value < 0) {
+      buffer.push_back('-');
+      magnitude = 0 - magnitude;
+    }
+    writeDigits(magnitude, 0);
+  }
+
+  /**
+   * writeDigits Writes an unsigned integer, with at least min_digits digits.
+   */
+  void writeDigits(uint64_t value, int min_digits) {
+    char digits[20];
+    int n = 0;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value != 0 || n < min_digits);
+    while (n > 0) {
+      buffer.push_back(digits[--n]);
+    }
+  }
+
+  /**
+   * writeNumber Writes a number with kSignificantDigits significant digits,
+   *   trailing zeros removed, in fixed notation for magnitudes in
+   *   [1e-5, 1e10) and in scientific notation otherwise. Non-finite values
+   *   are written as null, as JSON has no representation for them.
+   */
+  void writeNumber(double value) {
+    if (!(value - value == 0.0)) {
+      buffer.append("null");
+      return;
+    }
+    if (value == 0.0) {
+      buffer.push_back('0');
+      return;
+    }
+    if (value < 0) {
+      buffer.push_back('-');
+      value = -value;
+    }
+
+    // value = mantissa * 10^(exponent - kSignificantDigits + 1), with
+    // mantissa holding exactly kSignificantDigits digits
+    int exponent = static_cast<int>(floor(log10(value)));
+    uint64_t const low = 1000000000ULL;  // 10^(kSignificantDigits - 1)
+    int shift = kSignificantDigits - 1 - exponent;
+    if (shift > 300) {
+      // 10^shift overflows for the smallest (subnormal) values
+      value *= 1e100;
+      shift -= 100;
+    }
+    uint64_t mantissa = static_cast<uint64_t>(value * pow10(shift) + 0.5);
+    if (mantissa >= 10 * low) {
+      mantissa = (mantissa + 5) / 10;
+      ++exponent;
+    } else if (mantissa < low) {
+      mantissa *= 10;
+      --exponent;
+    }
+
+    // Drop the trailing zeros
+    int digits = kSignificantDigits;
+    while (digits > 1 && mantissa % 10 == 0) {
+      mantissa /= 10;
+      --digits;
+    }
+
+    if (exponent >= -5 && exponent < 10) {
+      int const integer_digits = exponent + 1;
+      if (integer_digits <= 0) {
+        // 0.000ddd
+        buffer.append("0.");
+        buffer.append(-integer_digits, '0');
+        writeDigits(mantissa, digits);
+      } else if (digits <= integer_digits) {
+        // ddd000
+        writeDigits(mantissa, digits);
+        buffer.append(integer_digits - digits, '0');
+      } else {
+        // ddd.ddd
+        uint64_t const scale = pow10i(digits - integer_digits);
+        writeDigits(mantissa / scale, integer_digits);
+        buffer.push_back('.');
+        writeDigits(mantissa % scale, digits - integer_digits);
+      }
+    } else {
+      // d.ddde[-]xx
+      uint64_t const scale = pow10i(digits - 1);
+      writeDigits(mantissa / scale, 1);
+      if (digits > 1) {
+        buffer.push_back('.');
+        writeDigits(mantissa % scale, digits - 1);
+      }
+      buffer.push_back('e');
+      writeInteger(exponent);
+    }
+  }
+
+  static double pow10(int n) {
+    double result = 1.0;
+    double base = n < 0 ? 0.1 : 10.0;
+    for (int k = n < 0 ? -n : n; k > 0; k >>= 1) {
+      if (k & 1) {
+        result *= base;
+      }
+      base *= base;
+    }
+    return result;
+  }
+
+  static uint64_t pow10i(int n) {
+    uint64_t result = 1;
+    while (n-- > 0) {
+      result *= 10;
+    }
+    return result;
+  }
+
+  std::string buffer;
+  bool first_field;
+  bool first_item;
+};
+
+#endif  // REPLY_WRITER_H_
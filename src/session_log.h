@@ -0,0 +1,227 @@
+/**
+ * session_log.h
+ * Binary log of the telemetry processed by the filter, for the
+ * deterministic replay of live sessions (see replay.cpp).
+ *
+ * Layout (native endianness):
+ *   header: magic "PFSL", version, RNG seed, delta_t, sensor_range,
+ *           sigma_pos[3], sigma_landmark[2], number of particles, sampling,
+ *           regularization kernel and bandwidth scale, deduplication,
+ *           kidnap recovery, global initialization
+ *   frames: kind (init / prediction), three control values (sense x, y,
+ *           theta for init, velocity, yaw rate, 0 for prediction), number
+ *           of observations, and their (x, y) in vehicle coordinates
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef SESSION_LOG_H_
+#define SESSION_LOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "helper_functions.h"
+
+/**
+ * Parameters of a recorded session.
+ */
+struct session_header_s {
+  char magic[4];
+  uint32_t version;
+  uint32_t seed;            // Seed of the filter random engine
+  double delta_t;           // Time elapsed between measurements [s]
+  double sensor_range;      // Sensor range [m]
+  double sigma_pos[3];      // GPS measurement uncertainty
+  double sigma_landmark[2]; // Landmark measurement uncertainty
+  uint32_t num_particles;   // Number of particles of the filter
+  uint32_t sampling;        // Sampling scheme (session_header_s::Sampling)
+  uint32_t regularization;  // Resampling kernel (RegularizationKernel)
+  double bandwidth;         // Scale of the kernel bandwidth
+  uint32_t deduplicate;     // Deduplicated likelihood evaluation (0 / 1)
+  double dedup_epsilon;     // Deduplication quantization step [m]
+  uint32_t recovery;        // Kidnap recovery poses (RecoveryMode)
+  double recovery_alpha[2]; // Decay rates of the slow and fast averages
+  uint32_t global_init;     // Candidate poses of the global initialization
+                            //   (0 = GPS prior)
+
+  enum Sampling { SIR = 0, AUXILIARY = 1 };
+};
+
+/**
+ * One recorded telemetry frame.
+ */
+struct session_frame_s {
+  enum Kind { INIT = 0, PREDICTION = 1 };
+
+  uint32_t kind;
+  double control[3];  // INIT: sense x, y, theta. PREDICTION: v, yaw rate, 0
+  std::vector<LandmarkObs> observations;
+};
+
+const uint32_t kSessionLogVersion = 6;
+
+/**
+ * Appends the frames of a session to a file. A frame is built in a stdio
+ *   buffer and handed to the kernel in one write, so a frame costs a few
+ *   memory copies and a system call, and a killed server only loses the
+ *   frame being recorded.
+ */
+class SessionRecorder {
+ public:
+  SessionRecorder() : file(NULL), descriptor(-1) {}
+
+  ~SessionRecorder() {
+    close();
+  }
+
+  /**
+   * open Creates the log and writes its header.
+   * @output True if the file could be created
+   */
+  bool open(const std::string &filename, const session_header_s &header) {
+    close();
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+      return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 16);
+    descriptor = fileno(file);
+    // The header is written raw: it is copied field by field over zeroed
+    // memory, so that no uninitialized padding byte ends up in the file
+    session_header_s h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "PFSL", 4);
+    h.version = kSessionLogVersion;
+    h.seed = header.seed;
+    h.delta_t = header.delta_t;
+    h.sensor_range = header.sensor_range;
+    memcpy(h.sigma_pos, header.sigma_pos, sizeof(h.sigma_pos));
+    memcpy(h.sigma_landmark, header.sigma_landmark, sizeof(h.sigma_landmark));
+    h.num_particles = header.num_particles;
+    h.sampling = header.sampling;
+    h.regularization = header.regularization;
+    h.bandwidth = header.bandwidth;
+    h.deduplicate = header.deduplicate;
+    h.dedup_epsilon = header.dedup_epsilon;
+    h.recovery = header.recovery;
+    memcpy(h.recovery_alpha, header.recovery_alpha, sizeof(h.recovery_alpha));
+    h.global_init = header.global_init;
+    return fwrite(&h, sizeof(h), 1, file) == 1 && fflush(file) == 0;
+  }
+
+  bool isOpen() const {
+    return file != NULL;
+  }
+
+  /**
+   * record Appends a frame, and flushes it.
+   */
+  void record(uint32_t kind, double c0, double c1, double c2,
+              const std::vector<LandmarkObs> &observations) {
+    if (file == NULL) {
+      return;
+    }
+    double const control[3] = {c0, c1, c2};
+    uint32_t const count = observations.size();
+    fwrite(&kind, sizeof(kind), 1, file);
+    fwrite(control, sizeof(control), 1, file);
+    fwrite(&count, sizeof(count), 1, file);
+    for (uint32_t i = 0; i < count; ++i) {
+      double const xy[2] = {observations[i].x, observations[i].y};
+      fwrite(xy, sizeof(xy), 1, file);
+    }
+    fflush(file);
+  }
+
+  void close() {
+    if (file != NULL) {
+      fclose(file);
+      file = NULL;
+      descriptor = -1;
+    }
+  }
+
+  /**
+   * closeFromSignal Closes the file from a signal handler (async-signal-safe:
+   *   the stdio buffer is dropped, which only holds a frame being recorded).
+   *   The recorder must not be used afterwards.
+   */
+  void closeFromSignal() {
+    if (descriptor >= 0) {
+      ::close(descriptor);
+      descriptor = -1;
+    }
+  }
+
+ private:
+  FILE *file;
+  int descriptor;  // Descriptor of file, for closeFromSignal
+};
+
+/**
+ * Reads back the frames of a recorded session.
+ */
+class SessionReader {
+ public:
+  SessionReader() : file(NULL) {}
+
+  ~SessionReader() {
+    if (file != NULL) {
+      fclose(file);
+    }
+  }
+
+  /**
+   * open Opens a log and reads its header.
+   * @output True if the file is a session log of the supported version
+   */
+  bool open(const std::string &filename, session_header_s &header) {
+    file = fopen(filename.c_str(), "rb");
+    if (file == NULL) {
+      return false;
+    }
+    return fread(&header, sizeof(header), 1, file) == 1 &&
+           memcmp(header.magic, "PFSL", 4) == 0 &&
+           header.version == kSessionLogVersion;
+  }
+
+  /**
+   * next Reads the next frame.
+   * @output False at the end of the log (or on a truncated frame)
+   */
+  bool next(session_frame_s &frame) {
+    uint32_t count = 0;
+    if (fread(&frame.kind, sizeof(frame.kind), 1, file) != 1 ||
+        fread(frame.control, sizeof(frame.control), 1, file) != 1 ||
+        fread(&count, sizeof(count), 1, file) != 1) {
+      return false;
+    }
+    frame.observations.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      double xy[2];
+      if (fread(xy, sizeof(xy), 1, file) != 1) {
+        return false;
+      }
+      frame.observations[i].id = 0;
+      frame.observations[i].x = xy[0];
+      frame.observations[i].y = xy[1];
+    }
+    return true;
+  }
+
+  /**
+   * rewind Goes back to the first frame.
+   */
+  void rewind() {
+    fseek(file, sizeof(session_header_s), SEEK_SET);
+  }
+
+ private:
+  FILE *file;
+};
+
+#endif  // SESSION_LOG_H_
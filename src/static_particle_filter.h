@@ -0,0 +1,243 @@
+/**
+ * static_particle_filter.h
+ * Compile-time configurable 2D particle filter.
+ *
+ * The motion model, the measurement model and the resampler are policy
+ * classes, and the number of particles is a template parameter, so every
+ * combination is compiled into its own fully inlined pipeline working on
+ * fixed-size storage. The runtime-configurable ParticleFilter class remains
+ * the general implementation (association modes, gating, floors, ...);
+ * DefaultStaticParticleFilter reproduces its default pipeline, with the
+ * same motion and measurement kernels.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef STATIC_PARTICLE_FILTER_H_
+#define STATIC_PARTICLE_FILTER_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+#include "helper_functions.h"
+#include "measurement_models.h"
+#include "motion_models.h"
+
+/**
+ * Lean particle state (no debugging associations).
+ */
+struct ParticleState {
+  pf_real x;
+  pf_real y;
+  pf_real theta;
+  double weight;  // Double even in single precision (see Particle)
+};
+
+/**
+ * Motion policy: bicycle model (CTRV) with additive Gaussian noise, with the
+ *   straight line kernel when the yaw rate is negligible.
+ */
+struct BicycleMotion {
+  template <size_t N, class Generator>
+  static void predict(std::array<ParticleState, N> &states, double delta_t,
+                      const double std_pos[], double velocity,
+                      double yaw_rate, Generator &gen) {
+    if (fabs(yaw_rate) < kStraightYawRate) {
+      move<StraightLineMotion>(states,
+                               StraightLineMotion::step(delta_t, velocity, 0.0),
+                               std_pos, gen);
+    } else {
+      move<CtrvMotion>(states, CtrvMotion::step(delta_t, velocity, yaw_rate),
+                       std_pos, gen);
+    }
+  }
+
+  template <class Motion, size_t N, class Generator>
+  static void move(std::array<ParticleState, N> &states, const MotionStep &step,
+                   const double std_pos[], Generator &gen) {
+    std::normal_distribution<pf_real> noise_x(0.0, std_pos[0]);
+    std::normal_distribution<pf_real> noise_y(0.0, std_pos[1]);
+    std::normal_distribution<pf_real> noise_theta(0.0, std_pos[2]);
+
+    for (size_t i = 0; i < N; ++i) {
+      ParticleState &p = states[i];
+      Motion::apply(step, p.x, p.y, p.theta);
+      p.x += noise_x(gen);
+      p.y += noise_y(gen);
+      p.theta += noise_theta(gen);
+    }
+  }
+};
+
+/**
+ * Measurement policy: nearest neighbor association and bivariate Gaussian
+ *   likelihood of the observations.
+ */
+struct GaussianMeasurement {
+  // Constants of a frame
+  struct Frame {
+    pf_real sensor_range;
+    GaussianLikelihood likelihood;
+  };
+
+  static Frame frame(double sensor_range, const double std_landmark[]) {
+    Frame f;
+    f.sensor_range = sensor_range;
+    f.likelihood.configure(std_landmark, 0.0, 0.0);
+    return f;
+  }
+
+  /**
+   * likelihood Returns the likelihood of the observations for a particle.
+   * @param predicted Scratch vector for the landmarks in range
+   */
+  static double likelihood(const ParticleState &p,
+                           const std::vector<LandmarkObs> &observations,
+                           const Map &map_landmarks, const Frame &f,
+                           std::vector<LandmarkObs> &predicted) {
+    predicted.clear();
+    landmarks_in_range(map_landmarks, p.x, p.y, f.sensor_range, predicted);
+
+    ObservationTransform const transform(p.x, p.y, p.theta);
+    double prob = 1.0;
+
+    for (size_t j = 0; j < observations.size(); ++j) {
+      pf_real xm, ym;
+      transform.apply(observations[j], xm, ym);
+
+      // An observation without landmark in range scores the outlier
+      // likelihood, as in ParticleFilter
+      int const nearest = f.likelihood.nearest(predicted, xm, ym);
+      if (nearest < 0) {
+        prob *= f.likelihood.outlier;
+        continue;
+      }
+      prob *= f.likelihood.score(xm - predicted[nearest].x,
+                                 ym - predicted[nearest].y);
+    }
+    return prob;
+  }
+};
+
+/**
+ * Resampler policy: sampling wheel.
+ */
+struct WheelResampler {
+  template <size_t N, class Generator>
+  static void resample(std::array<ParticleState, N> &states,
+                       std::array<ParticleState, N> &scratch,
+                       Generator &gen) {
+    double highest_weight = 0.0;
+    for (size_t i = 0; i < N; ++i) {
+      highest_weight = std::max(highest_weight, states[i].weight);
+    }
+
+    std::uniform_int_distribution<size_t> dist_index(0, N - 1);
+    std::uniform_real_distribution<double> dist_beta(0.0, 2.0 * highest_weight);
+
+    size_t index = dist_index(gen);
+    double beta = 0.0;
+    for (size_t j = 0; j < N; ++j) {
+      beta += dist_beta(gen);
+      while (beta > states[index].weight) {
+        beta -= states[index].weight;
+        index = (index + 1) % N;
+      }
+      scratch[j] = states[index];
+    }
+    states.swap(scratch);
+  }
+};
+
+/**
+ * Particle filter with compile-time motion model, measurement model,
+ *   resampler and number of particles. Same interface as ParticleFilter.
+ *   The particles are stored inline: allocate large instances on the heap.
+ */
+template <class Motion, class Measurement, class Resampler, size_t N>
+class StaticParticleFilter {
+ public:
+  static const size_t num_particles = N;
+
+  StaticParticleFilter() : is_initialized(false) {}
+
+  /**
+   * init Initializes the particles to a Gaussian distribution around the
+   *   first position, and all the weights to 1.
+   */
+  void init(double x, double y, double theta, double std[]) {
+    std::normal_distribution<pf_real> dist_x(x, std[0]);
+    std::normal_distribution<pf_real> dist_y(y, std[1]);
+    std::normal_distribution<pf_real> dist_theta(theta, std[2]);
+    for (size_t i = 0; i < N; ++i) {
+      particles[i].x = dist_x(gen);
+      particles[i].y = dist_y(gen);
+      particles[i].theta = dist_theta(gen);
+      particles[i].weight = 1.0;
+    }
+    is_initialized = true;
+  }
+
+  /**
+   * prediction Predicts the state for the next time step with the motion
+   *   policy.
+   */
+  void prediction(double delta_t, double std_pos[], double velocity,
+                  double yaw_rate) {
+    Motion::predict(particles, delta_t, std_pos, velocity, yaw_rate, gen);
+  }
+
+  /**
+   * updateWeights Updates the (normalized) weights of the particles with
+   *   the measurement policy.
+   */
+  void updateWeights(double sensor_range, double std_landmark[],
+                     const std::vector<LandmarkObs> &observations,
+                     const Map &map_landmarks) {
+    typename Measurement::Frame const f =
+        Measurement::frame(sensor_range, std_landmark);
+    double cumulated_weight = 0.0;
+    for (size_t i = 0; i < N; ++i) {
+      particles[i].weight = Measurement::likelihood(particles[i], observations,
+                                                    map_landmarks, f,
+                                                    predicted);
+      cumulated_weight += particles[i].weight;
+    }
+    // (uniform if all the likelihoods underflowed)
+    cumulated_weight = uniform_if_degenerate(particles.data(), N,
+                                             cumulated_weight);
+    for (size_t i = 0; i < N; ++i) {
+      particles[i].weight /= cumulated_weight;
+    }
+  }
+
+  /**
+   * resample Resamples the particles with the resampler policy.
+   */
+  void resample() {
+    Resampler::resample(particles, scratch, gen);
+  }
+
+  bool initialized() const {
+    return is_initialized;
+  }
+
+  // Set of current particles
+  std::array<ParticleState, N> particles;
+
+ private:
+  bool is_initialized;
+  std::array<ParticleState, N> scratch;
+  std::vector<LandmarkObs> predicted;
+  std::default_random_engine gen;
+};
+
+// Default pipeline of ParticleFilter: bicycle model, Gaussian likelihood,
+// sampling wheel, 1000 particles
+typedef StaticParticleFilter<BicycleMotion, GaussianMeasurement,
+                             WheelResampler, 1000> DefaultStaticParticleFilter;
+
+#endif  // STATIC_PARTICLE_FILTER_H_
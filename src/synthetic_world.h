@@ -0,0 +1,168 @@
+/**
+ * synthetic_world.h
+ * Generators of synthetic maps, trajectories and sensor data, used by the
+ * benchmarks and by the world generator (generate_world.cpp) to run the
+ * filter on maps much larger than data/map_data.txt.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef SYNTHETIC_WORLD_H_
+#define SYNTHETIC_WORLD_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "helper_functions.h"
+#include "map.h"
+
+/**
+ * make_synthetic_map Fills a map with landmarks uniformly distributed over
+ *   the rectangle [0, width] x [0, height], with ids 1..num_landmarks.
+ * @param num_landmarks Number of landmarks
+ * @param width, height Size of the mapped area [m]
+ * @param gen Random engine
+ * @param map Map to fill (cleared first)
+ */
+template <class Generator>
+void make_synthetic_map(int num_landmarks, double width, double height,
+                        Generator &gen, Map &map) {
+  std::uniform_real_distribution<float> dist_x(0.0f, width);
+  std::uniform_real_distribution<float> dist_y(0.0f, height);
+
+  map.landmark_list.clear();
+  map.landmark_list.reserve(num_landmarks);
+  Map::single_landmark_s landmark;
+  for (int i = 0; i < num_landmarks; ++i) {
+    landmark.id_i = i + 1;
+    landmark.x_f = dist_x(gen);
+    landmark.y_f = dist_y(gen);
+    map.landmark_list.push_back(landmark);
+  }
+  map.buildIdLookup();
+}
+
+/**
+ * make_synthetic_observations Simulates the sensor: returns the landmarks
+ *   within sensor range of the pose, in vehicle coordinates, with additive
+ *   Gaussian noise. The landmarks are found with the grid index of the map
+ *   if it has been built, and observed in the order of the map either way.
+ * @param map Map of the landmarks
+ * @param x, y, theta Pose of the vehicle [m, m, rad]
+ * @param sensor_range Range [m] of sensor
+ * @param std_landmark[] Array of dimension 2 [Landmark measurement
+ *   uncertainty [x [m], y [m]]]
+ * @param gen Random engine
+ */
+template <class Generator>
+std::vector<LandmarkObs> make_synthetic_observations(
+    const Map &map, double x, double y, double theta, double sensor_range,
+    const double std_landmark[], Generator &gen) {
+  std::normal_distribution<double> noise_x(0.0, std_landmark[0]);
+  std::normal_distribution<double> noise_y(0.0, std_landmark[1]);
+  double const cos_theta = cos(theta);
+  double const sin_theta = sin(theta);
+
+  double const range2 = sensor_range * sensor_range;
+  std::vector<int> in_range;
+  if (map.hasIndex()) {
+    map.forEachInRange(x, y, sensor_range,
+        [&](const Map::cell_landmark_s &landmark) {
+      double const dx = map.landmark_list[landmark.index].x_f - x;
+      double const dy = map.landmark_list[landmark.index].y_f - y;
+      if (dx * dx + dy * dy <= range2) {
+        in_range.push_back(landmark.index);
+      }
+    });
+    std::sort(in_range.begin(), in_range.end());
+  } else {
+    for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+      double const dx = map.landmark_list[k].x_f - x;
+      double const dy = map.landmark_list[k].y_f - y;
+      if (dx * dx + dy * dy <= range2) {
+        in_range.push_back(static_cast<int>(k));
+      }
+    }
+  }
+
+  std::vector<LandmarkObs> observations;
+  LandmarkObs obs;
+  for (size_t n = 0; n < in_range.size(); ++n) {
+    double const dx = map.landmark_list[in_range[n]].x_f - x;
+    double const dy = map.landmark_list[in_range[n]].y_f - y;
+    obs.id = 0;
+    obs.x = cos_theta * dx + sin_theta * dy + noise_x(gen);
+    obs.y = -sin_theta * dx + cos_theta * dy + noise_y(gen);
+    observations.push_back(obs);
+  }
+  return observations;
+}
+
+/**
+ * make_synthetic_trajectory Simulates a vehicle driving at constant speed
+ *   inside the rectangle [0, width] x [0, height], starting from its center.
+ *   The yaw rate changes randomly every 2 s, and turns the vehicle back
+ *   towards the center whenever it gets within 100 m of the border (so the
+ *   area should be at least 300 m wide).
+ * @param width, height Size of the area [m]
+ * @param num_steps Number of time steps
+ * @param delta_t Time between two steps [s]
+ * @param velocity Velocity of the vehicle [m/s]
+ * @param gen Random engine
+ * @param gt Filled with the ground truth pose of every step
+ * @param controls Filled with the (noiseless) controls from every step to
+ *   the next one
+ */
+template <class Generator>
+void make_synthetic_trajectory(double width, double height, int num_steps,
+                               double delta_t, double velocity,
+                               Generator &gen, std::vector<ground_truth> &gt,
+                               std::vector<control_s> &controls) {
+  double const max_yaw_rate = 0.2;
+  double const margin = 100.0;
+  int const steps_per_segment = static_cast<int>(2.0 / delta_t);
+  std::uniform_real_distribution<double> dist_yaw_rate(-max_yaw_rate,
+                                                       max_yaw_rate);
+  std::uniform_real_distribution<double> dist_theta(-M_PI, M_PI);
+
+  ground_truth pose;
+  pose.x = width / 2;
+  pose.y = height / 2;
+  pose.theta = dist_theta(gen);
+  control_s control;
+  control.velocity = velocity;
+  control.yawrate = 0.0;
+
+  gt.clear();
+  controls.clear();
+  for (int t = 0; t < num_steps; ++t) {
+    gt.push_back(pose);
+
+    if (pose.x < margin || pose.x > width - margin ||
+        pose.y < margin || pose.y > height - margin) {
+      // Turn towards the center of the area
+      double const to_center = atan2(height / 2 - pose.y, width / 2 - pose.x);
+      double const error = remainder(to_center - pose.theta, 2.0 * M_PI);
+      control.yawrate = fabs(error) < 0.1 ? 0.0 :
+                        (error > 0 ? max_yaw_rate : -max_yaw_rate);
+    } else if (t % steps_per_segment == 0) {
+      control.yawrate = dist_yaw_rate(gen);
+    }
+    controls.push_back(control);
+
+    // Bicycle model
+    if (fabs(control.yawrate) < 0.00001) {
+      pose.x += velocity * delta_t * cos(pose.theta);
+      pose.y += velocity * delta_t * sin(pose.theta);
+    } else {
+      double const theta_end = pose.theta + control.yawrate * delta_t;
+      pose.x += velocity / control.yawrate * (sin(theta_end) - sin(pose.theta));
+      pose.y += velocity / control.yawrate * (cos(pose.theta) - cos(theta_end));
+      pose.theta = theta_end;
+    }
+  }
+}
+
+#endif  // SYNTHETIC_WORLD_H_
@@ -0,0 +1,51 @@
+/**
+ * tile_map.cpp
+ * Converts a map in the format of read_map_data to a tiled map file
+ * (tiled_map.h), for the server to stream it with --tiled-map. The map is
+ * not loaded: its landmarks are bucketed by tile through temporary files.
+ *
+ * Usage: pf_tile_map <map file> <tiled map file> [tile size [m]]
+ *                    [bucket memory [MB]]
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <iostream>
+#include "tiled_map.h"
+
+// Parses a whole command line value as a positive number.
+bool parsePositive(const char *text, double &value) {
+  char *end;
+  errno = 0;
+  value = strtod(text, &end);
+  return end != text && *end == '\0' && errno == 0 && std::isfinite(value) &&
+         value > 0.0;
+}
+
+int main(int argc, char *argv[]) {
+  double tile_size = 500.0;
+  double bucket_mb = 64.0;
+  if (argc < 3 || argc > 5 ||
+      (argc > 3 && !parsePositive(argv[3], tile_size)) ||
+      (argc > 4 && !parsePositive(argv[4], bucket_mb))) {
+    std::cerr << "Usage: " << argv[0]
+              << " <map file> <tiled map file> [tile size] [bucket memory MB]"
+              << std::endl;
+    return -1;
+  }
+
+  size_t num_landmarks = 0;
+  if (!convert_tiled_map(argv[1], tile_size, argv[2],
+                         static_cast<size_t>(bucket_mb * (1 << 20)),
+                         num_landmarks)) {
+    std::cerr << "Error: Could not convert " << argv[1] << " to " << argv[2]
+              << std::endl;
+    return -1;
+  }
+  std::cout << "Wrote " << num_landmarks << " landmarks in " << tile_size
+            << " m tiles to " << argv[2] << std::endl;
+  return 0;
+}
@@ -0,0 +1,818 @@
+/**
+ * tiled_map.h
+ * Tiled landmark store for maps larger than memory.
+ *
+ * The landmarks are bucketed into fixed-size square tiles, stored in a single
+ * file with a tile directory. TiledMapStore keeps the recently used tiles in
+ * an LRU cache bounded by a memory budget, loads the tiles ahead of the
+ * vehicle on a background thread, and exposes the tiles around the particle
+ * cloud as an ordinary (indexed) Map, which is what updateWeights queries.
+ * The background thread also builds the Map of the next tiles the vehicle
+ * is heading to, which update swaps in when the vehicle gets there.
+ *
+ * File layout (native endianness):
+ *   header:    magic "PFTM", version, tile size, number of tiles
+ *   directory: for every non-empty tile, its coordinates, number of
+ *              landmarks and offset in the file
+ *   tiles:     the Map::single_landmark_s records of every tile
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef TILED_MAP_H_
+#define TILED_MAP_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "async_logger.h"
+#include "map.h"
+
+struct tiled_map_header_s {
+  char magic[4];
+  uint32_t version;
+  double tile_size;    // Side of the tiles [m]
+  uint32_t num_tiles;  // Number of entries of the directory
+  uint32_t reserved;
+};
+
+struct tile_entry_s {
+  int32_t tx;          // Tile coordinates: floor(x / tile_size)
+  int32_t ty;          //   and floor(y / tile_size)
+  uint32_t count;      // Number of landmarks
+  uint32_t reserved;
+  uint64_t offset;     // Offset of the landmarks in the file [bytes]
+};
+
+const uint32_t kTiledMapVersion = 1;
+
+typedef std::vector<Map::single_landmark_s> MapTile;
+
+inline uint64_t tile_key(int32_t tx, int32_t ty) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(tx)) << 32) |
+         static_cast<uint32_t>(ty);
+}
+
+inline int32_t tile_coord(double v, double tile_size) {
+  return static_cast<int32_t>(floor(v / tile_size));
+}
+
+/**
+ * write_tiled_map_directory Writes the header and the directory of a tiled
+ *   map file, and sets the offsets of the tiles, stored in key order after
+ *   the directory.
+ * @param file Tiled map file, at its beginning
+ * @param tile_size Side of the tiles [m]
+ * @param directory Entries of the non-empty tiles by key, with their
+ *   coordinates and number of landmarks (their offset is set)
+ * @output True if the header and the directory could be written
+ */
+inline bool write_tiled_map_directory(
+    FILE *file, double tile_size, std::map<uint64_t, tile_entry_s> &directory) {
+  tiled_map_header_s header;
+  memcpy(header.magic, "PFTM", 4);
+  header.version = kTiledMapVersion;
+  header.tile_size = tile_size;
+  header.num_tiles = directory.size();
+  header.reserved = 0;
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  uint64_t offset = sizeof(header) + directory.size() * sizeof(tile_entry_s);
+  for (std::map<uint64_t, tile_entry_s>::iterator it = directory.begin();
+       it != directory.end(); ++it) {
+    tile_entry_s &entry = it->second;
+    entry.offset = offset;
+    offset += entry.count * sizeof(Map::single_landmark_s);
+    ok = ok && fwrite(&entry, sizeof(entry), 1, file) == 1;
+  }
+  return ok;
+}
+
+/**
+ * tile_entry Returns the directory entry of a tile, without landmarks yet.
+ */
+inline tile_entry_s tile_entry(uint64_t key) {
+  tile_entry_s entry;
+  entry.tx = static_cast<int32_t>(key >> 32);
+  entry.ty = static_cast<int32_t>(key & 0xffffffff);
+  entry.count = 0;
+  entry.reserved = 0;
+  entry.offset = 0;
+  return entry;
+}
+
+/**
+ * write_tiled_map Writes a map as a tiled map file.
+ * @param map Map to write
+ * @param tile_size Side of the tiles [m]
+ * @param filename Name of the tiled map file
+ * @output True if the file could be written
+ */
+inline bool write_tiled_map(const Map &map, double tile_size,
+                            const std::string &filename) {
+  // Tiles in key order, for a deterministic layout
+  std::map<uint64_t, MapTile> tiles;
+  for (size_t i = 0; i < map.landmark_list.size(); ++i) {
+    const Map::single_landmark_s &landmark = map.landmark_list[i];
+    tiles[tile_key(tile_coord(landmark.x_f, tile_size),
+                   tile_coord(landmark.y_f, tile_size))].push_back(landmark);
+  }
+
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    return false;
+  }
+  std::map<uint64_t, tile_entry_s> directory;
+  for (std::map<uint64_t, MapTile>::const_iterator it = tiles.begin();
+       it != tiles.end(); ++it) {
+    tile_entry_s &entry = directory[it->first] = tile_entry(it->first);
+    entry.count = it->second.size();
+  }
+  bool ok = write_tiled_map_directory(file, tile_size, directory);
+  for (std::map<uint64_t, MapTile>::const_iterator it = tiles.begin();
+       it != tiles.end(); ++it) {
+    ok = ok && fwrite(it->second.data(), sizeof(Map::single_landmark_s),
+                      it->second.size(), file) == it->second.size();
+  }
+  return fclose(file) == 0 && ok;
+}
+
+/**
+ * Landmark of a map being converted, with the key of its tile.
+ */
+struct tile_record_s {
+  uint64_t key;
+  Map::single_landmark_s landmark;
+};
+
+/**
+ * read_map_record Parses a line of a map file (format of read_map_data).
+ * @output False if the line is not a landmark
+ */
+inline bool read_map_record(const std::string &line,
+                            Map::single_landmark_s &landmark) {
+  std::istringstream iss(line);
+  return static_cast<bool>(iss >> landmark.x_f >> landmark.y_f >>
+                           landmark.id_i);
+}
+
+/**
+ * convert_tiled_map Converts a map file (format of read_map_data) to a tiled
+ *   map file without loading the whole map: a first pass counts the
+ *   landmarks, a second one buckets them by tile into temporary files, and
+ *   the buckets are then loaded one at a time, their tiles written at their
+ *   offset. The file is the same as written by write_tiled_map.
+ * @param map_file Name of the map file
+ * @param tile_size Side of the tiles [m]
+ * @param filename Name of the tiled map file
+ * @param bucket_bytes Memory budget of a bucket [bytes]
+ * @param num_landmarks Set to the number of landmarks converted
+ * @output True if the map could be read and the file written
+ */
+inline bool convert_tiled_map(const std::string &map_file, double tile_size,
+                              const std::string &filename,
+                              size_t bucket_bytes, size_t &num_landmarks) {
+  std::string line;
+  Map::single_landmark_s landmark;
+
+  // First pass: number of landmarks, hence of buckets (bounded by the
+  // number of open files)
+  std::ifstream in(map_file.c_str());
+  if (!in) {
+    return false;
+  }
+  num_landmarks = 0;
+  while (getline(in, line)) {
+    num_landmarks += read_map_record(line, landmark);
+  }
+  size_t const total_bytes = num_landmarks * sizeof(tile_record_s);
+  size_t const num_buckets = std::min<size_t>(
+      512, std::max<size_t>(1, (total_bytes + bucket_bytes - 1) /
+                                   std::max<size_t>(bucket_bytes, 1)));
+
+  // Second pass: records to the bucket of their tile, and size of the tiles
+  std::vector<FILE *> buckets(num_buckets, static_cast<FILE *>(NULL));
+  bool ok = true;
+  for (size_t b = 0; b < num_buckets && ok; ++b) {
+    buckets[b] = tmpfile();
+    ok = buckets[b] != NULL;
+  }
+  std::map<uint64_t, tile_entry_s> directory;
+  in.clear();
+  in.seekg(0);
+  while (ok && getline(in, line)) {
+    tile_record_s record;
+    if (!read_map_record(line, record.landmark)) {
+      continue;
+    }
+    record.key = tile_key(tile_coord(record.landmark.x_f, tile_size),
+                          tile_coord(record.landmark.y_f, tile_size));
+    std::map<uint64_t, tile_entry_s>::iterator it =
+        directory.find(record.key);
+    if (it == directory.end()) {
+      it = directory.insert(std::make_pair(record.key,
+                                           tile_entry(record.key))).first;
+    }
+    ++it->second.count;
+    size_t const b = ((record.key * 0x9E3779B97F4A7C15ull) >> 32) % num_buckets;
+    ok = fwrite(&record, sizeof(record), 1, buckets[b]) == 1;
+  }
+
+  // Directory, then the tiles of each bucket (all the landmarks of a tile
+  // are in the same bucket, in map order)
+  FILE *file = ok ? fopen(filename.c_str(), "wb") : NULL;
+  ok = file != NULL && write_tiled_map_directory(file, tile_size, directory);
+  std::vector<tile_record_s> records;
+  MapTile tile;
+  for (size_t b = 0; b < num_buckets && ok; ++b) {
+    off_t const size = fseeko(buckets[b], 0, SEEK_END) == 0 ?
+                       ftello(buckets[b]) : -1;
+    records.resize(size / sizeof(tile_record_s));
+    ok = size >= 0 && fseeko(buckets[b], 0, SEEK_SET) == 0 &&
+         fread(records.data(), sizeof(tile_record_s), records.size(),
+               buckets[b]) == records.size();
+    std::stable_sort(records.begin(), records.end(),
+                     [](const tile_record_s &lhs, const tile_record_s &rhs) {
+      return lhs.key < rhs.key;
+    });
+    for (size_t first = 0; first < records.size() && ok;) {
+      size_t last = first;
+      tile.clear();
+      while (last < records.size() && records[last].key == records[first].key) {
+        tile.push_back(records[last++].landmark);
+      }
+      ok = fseeko(file, directory[records[first].key].offset, SEEK_SET) == 0 &&
+           fwrite(tile.data(), sizeof(Map::single_landmark_s), tile.size(),
+                  file) == tile.size();
+      first = last;
+    }
+  }
+
+  for (size_t b = 0; b < num_buckets; ++b) {
+    if (buckets[b] != NULL) {
+      fclose(buckets[b]);
+    }
+  }
+  if (file != NULL) {
+    ok = fclose(file) == 0 && ok;
+  }
+  return ok;
+}
+
+/**
+ * Tiled map with an LRU tile cache and asynchronous prefetching. update()
+ *   must be called from a single thread (the one running the filter).
+ */
+class TiledMapStore {
+ public:
+  TiledMapStore() : tile_size(0.0), memory_budget(0), index_cell(25.0f),
+                    reader(NULL), prefetch_reader(NULL), frame(0),
+                    sync_loads(0), cache_bytes(0), active_bytes(0),
+                    prefetch_loads(0), prebuilt_bytes(0), prebuilt_maps(0),
+                    prebuilt_swaps(0), build_cell(25.0f),
+                    build_requested(false), running(false) {}
+
+  ~TiledMapStore() {
+    close();
+  }
+
+  /**
+   * open Opens a tiled map file and starts the prefetching thread.
+   * @param filename Name of the tiled map file
+   * @param budget_bytes Memory budget [bytes] of the tile cache and of the
+   *   active map (the merged copy of the tiles of the frame, with its grid
+   *   index). The tiles used by the current frame are kept even above the
+   *   budget.
+   * @output True if the file is a tiled map of the supported version
+   */
+  bool open(const std::string &filename, size_t budget_bytes) {
+    close();
+    reader = fopen(filename.c_str(), "rb");
+    prefetch_reader = fopen(filename.c_str(), "rb");
+    if (reader == NULL || prefetch_reader == NULL) {
+      close();
+      return false;
+    }
+
+    tiled_map_header_s header;
+    if (fread(&header, sizeof(header), 1, reader) != 1 ||
+        memcmp(header.magic, "PFTM", 4) != 0 ||
+        header.version != kTiledMapVersion) {
+      close();
+      return false;
+    }
+    tile_size = header.tile_size;
+    memory_budget = budget_bytes;
+    directory.reserve(header.num_tiles);
+    for (uint32_t t = 0; t < header.num_tiles; ++t) {
+      tile_entry_s entry;
+      if (fread(&entry, sizeof(entry), 1, reader) != 1) {
+        close();
+        return false;
+      }
+      directory[tile_key(entry.tx, entry.ty)] = entry;
+    }
+
+    running = true;
+    prefetcher = std::thread(&TiledMapStore::prefetchLoop, this);
+    return true;
+  }
+
+  void close() {
+    if (prefetcher.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        running = false;
+      }
+      queue_ready.notify_one();
+      prefetcher.join();
+    }
+    if (reader != NULL) {
+      fclose(reader);
+      reader = NULL;
+    }
+    if (prefetch_reader != NULL) {
+      fclose(prefetch_reader);
+      prefetch_reader = NULL;
+    }
+    directory.clear();
+    cache.clear();
+    lru.clear();
+    cache_bytes = 0;
+    unreadable.clear();
+    active_keys.clear();
+    active_map = Map();
+    active_bytes = 0;
+    requested_keys.clear();
+    prebuilt.reset();
+    prebuilt_keys.clear();
+    prebuilt_bytes = 0;
+    build_requested = false;
+  }
+
+  /**
+   * setIndexCell Sets the cell size of the grid index of the active map.
+   * @param cell_size Side of the grid cells [m]
+   */
+  void setIndexCell(float cell_size) {
+    index_cell = cell_size;
+  }
+
+  /**
+   * update Makes resident the tiles overlapping an area, and makes them the
+   *   active map if they changed: the map built in the background for these
+   *   tiles is swapped in if there is one, else the map is built here
+   *   (loading the missing tiles synchronously). Then queues the
+   *   prefetching of the tiles ahead of the vehicle, and the building of
+   *   the map of the next tiles it will need. The tiles that cannot be read
+   *   are logged once and left out of the map.
+   * @param (min_x,min_y,max_x,max_y) Area needed by the frame: the bounding
+   *   box of the particle cloud, grown by the sensor range [m]
+   * @param heading Heading of the vehicle [rad]
+   * @param velocity Velocity of the vehicle [m/s]
+   * @param lookahead Time [s] ahead of the vehicle to prefetch
+   * @output The active map, valid until the next call
+   */
+  const Map &update(double min_x, double min_y, double max_x, double max_y,
+                    double heading, double velocity, double lookahead) {
+    ++frame;
+    frame_keys.clear();
+    collectTiles(min_x, min_y, max_x, max_y, frame_keys);
+
+    if (frame_keys != active_keys) {
+      if (!swapPrebuilt(frame_keys)) {
+        active_map.landmark_list.clear();
+        for (size_t t = 0; t < frame_keys.size(); ++t) {
+          std::shared_ptr<const MapTile> tile = acquire(frame_keys[t]);
+          active_map.landmark_list.insert(active_map.landmark_list.end(),
+                                          tile->begin(), tile->end());
+        }
+        active_map.buildIdLookup();
+        active_map.buildIndex(index_cell);
+      }
+      active_keys.swap(frame_keys);
+
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      active_bytes = active_map.memoryBytes();
+    } else {
+      // Refresh the recency of the tiles in use
+      for (size_t t = 0; t < active_keys.size(); ++t) {
+        acquire(active_keys[t]);
+      }
+    }
+
+    // Prefetch the windows along the path of the next seconds
+    double const distance = fabs(velocity) * lookahead;
+    int const num_windows = static_cast<int>(ceil(distance / (tile_size / 2)));
+    double const dx = (velocity < 0 ? -1 : 1) * cos(heading);
+    double const dy = (velocity < 0 ? -1 : 1) * sin(heading);
+    for (int w = 1; w <= num_windows; ++w) {
+      double const d = distance * w / num_windows;
+      prefetch_keys.clear();
+      collectTiles(min_x + d * dx, min_y + d * dy, max_x + d * dx,
+                   max_y + d * dy, prefetch_keys);
+      queuePrefetch(prefetch_keys);
+    }
+
+    // Build the map of the next tiles in the background (after their
+    // prefetching, queued first)
+    if (nextTiles(min_x, min_y, max_x, max_y, dx, dy, distance,
+                  prefetch_keys) && prefetch_keys != requested_keys) {
+      requested_keys = prefetch_keys;
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        build_keys = prefetch_keys;
+        build_cell = index_cell;
+        build_requested = true;
+      }
+      queue_ready.notify_one();
+    }
+    return active_map;
+  }
+
+  const Map &activeMap() const {
+    return active_map;
+  }
+
+  /**
+   * cacheBytes, syncLoads, prefetchLoads Return the memory used by the tile
+   *   cache and the active map, and the number of tiles loaded by update
+   *   (cache misses) and by the prefetching thread.
+   */
+  size_t cacheBytes() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache_bytes + active_bytes + prebuilt_bytes;
+  }
+  uint64_t syncLoads() const {
+    return sync_loads;
+  }
+  uint64_t prefetchLoads() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return prefetch_loads;
+  }
+
+  /**
+   * prebuiltMaps, prebuiltSwaps Return the number of maps built in the
+   *   background, and of those update swapped in.
+   */
+  uint64_t prebuiltMaps() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return prebuilt_maps;
+  }
+  uint64_t prebuiltSwaps() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return prebuilt_swaps;
+  }
+
+ private:
+  struct CachedTile {
+    std::shared_ptr<const MapTile> landmarks;
+    std::list<uint64_t>::iterator lru_position;
+    uint64_t last_frame;  // Last frame that used the tile (0: prefetched)
+  };
+
+  /**
+   * collectTiles Appends the keys of the non-empty tiles overlapping an area.
+   */
+  void collectTiles(double min_x, double min_y, double max_x, double max_y,
+                    std::vector<uint64_t> &keys) const {
+    int32_t const tx0 = tile_coord(min_x, tile_size);
+    int32_t const tx1 = tile_coord(max_x, tile_size);
+    int32_t const ty0 = tile_coord(min_y, tile_size);
+    int32_t const ty1 = tile_coord(max_y, tile_size);
+    for (int32_t ty = ty0; ty <= ty1; ++ty) {
+      for (int32_t tx = tx0; tx <= tx1; ++tx) {
+        uint64_t const key = tile_key(tx, ty);
+        if (directory.count(key)) {
+          keys.push_back(key);
+        }
+      }
+    }
+  }
+
+  /**
+   * nextTiles Collects the tiles of the area once it has moved along a
+   *   direction just enough for its set of tiles to change (an edge of the
+   *   area crossing a tile boundary), within a distance.
+   * @param (dx,dy) Direction of the motion
+   * @param distance Distance the area may move [m]
+   * @param keys Set to the keys of the next tiles
+   * @output False if the tiles do not change within the distance
+   */
+  bool nextTiles(double min_x, double min_y, double max_x, double max_y,
+                 double dx, double dy, double distance,
+                 std::vector<uint64_t> &keys) const {
+    double const margin = 1e-3 * tile_size;
+    double moved = 0.0;
+    for (int event = 0; event < 8; ++event) {
+      double const step = std::min(
+          std::min(boundaryDistance(min_x + moved * dx, dx),
+                   boundaryDistance(max_x + moved * dx, dx)),
+          std::min(boundaryDistance(min_y + moved * dy, dy),
+                   boundaryDistance(max_y + moved * dy, dy)));
+      moved += step + margin;
+      if (moved > distance) {
+        return false;
+      }
+      keys.clear();
+      collectTiles(min_x + moved * dx, min_y + moved * dy,
+                   max_x + moved * dx, max_y + moved * dy, keys);
+      if (keys != active_keys) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * boundaryDistance Returns the distance [m] along a direction (of
+   *   component d) from a coordinate to the next tile boundary.
+   */
+  double boundaryDistance(double v, double d) const {
+    if (fabs(d) < 1e-6) {
+      return std::numeric_limits<double>::infinity();
+    }
+    double const tile_start = floor(v / tile_size) * tile_size;
+    double const gap = d > 0 ? tile_start + tile_size - v : v - tile_start;
+    return gap / fabs(d);
+  }
+
+  /**
+   * swapPrebuilt Makes the map built in the background the active map, if
+   *   it has the given tiles, and refreshes the recency of the tiles.
+   * @output True if the map was swapped in
+   */
+  bool swapPrebuilt(const std::vector<uint64_t> &keys) {
+    std::unique_ptr<Map> previous;  // Freed outside of the lock
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!prebuilt || prebuilt_keys != keys) {
+      return false;
+    }
+    std::swap(active_map, *prebuilt);
+    previous.swap(prebuilt);
+    prebuilt_keys.clear();
+    prebuilt_bytes = 0;
+    ++prebuilt_swaps;
+    for (size_t t = 0; t < keys.size(); ++t) {
+      std::unordered_map<uint64_t, CachedTile>::iterator it =
+          cache.find(keys[t]);
+      if (it != cache.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru_position);
+        it->second.last_frame = frame;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * acquire Returns a tile used by the current frame, loading it on a miss.
+   */
+  std::shared_ptr<const MapTile> acquire(uint64_t key) {
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      std::unordered_map<uint64_t, CachedTile>::iterator it = cache.find(key);
+      if (it != cache.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru_position);
+        it->second.last_frame = frame;
+        return it->second.landmarks;
+      }
+      if (unreadable.count(key)) {
+        return std::make_shared<const MapTile>();
+      }
+    }
+
+    std::shared_ptr<MapTile> tile = std::make_shared<MapTile>();
+    bool const loaded = loadTile(reader, directory.find(key)->second, *tile);
+    ++sync_loads;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!loaded) {
+      return markUnreadable(key);
+    }
+    return insert(key, tile, frame);
+  }
+
+  /**
+   * markUnreadable Records a tile that could not be read, so that it is
+   *   neither cached nor loaded again, and returns it empty. cache_mutex
+   *   must be held.
+   */
+  std::shared_ptr<const MapTile> markUnreadable(uint64_t key) {
+    if (unreadable.insert(key).second) {
+      const tile_entry_s &entry = directory.find(key)->second;
+      async_logger().log(LOG_WARN, "tiled_map",
+                         "unreadable tile tx=%d ty=%d landmarks=%u "
+                         "offset=%llu", entry.tx, entry.ty, entry.count,
+                         static_cast<unsigned long long>(entry.offset));
+    }
+    return std::make_shared<const MapTile>();
+  }
+
+  /**
+   * insert Adds a tile to the cache (or returns the copy already cached by
+   *   the other thread) and evicts the least recently used tiles above the
+   *   memory budget. cache_mutex must be held.
+   */
+  std::shared_ptr<const MapTile> insert(uint64_t key,
+                                        std::shared_ptr<const MapTile> tile,
+                                        uint64_t used_frame) {
+    std::unordered_map<uint64_t, CachedTile>::iterator it = cache.find(key);
+    if (it != cache.end()) {
+      return it->second.landmarks;
+    }
+    lru.push_front(key);
+    CachedTile &cached = cache[key];
+    cached.landmarks = tile;
+    cached.lru_position = lru.begin();
+    cached.last_frame = used_frame;
+    cache_bytes += tileBytes(*tile);
+
+    while (cache_bytes + active_bytes + prebuilt_bytes > memory_budget &&
+           !lru.empty()) {
+      CachedTile &victim = cache[lru.back()];
+      if (victim.last_frame == frame) {
+        break;  // The rest of the list is used by the current frame
+      }
+      cache_bytes -= tileBytes(*victim.landmarks);
+      cache.erase(lru.back());
+      lru.pop_back();
+    }
+    return tile;
+  }
+
+  static size_t tileBytes(const MapTile &tile) {
+    return tile.size() * sizeof(Map::single_landmark_s) + sizeof(CachedTile);
+  }
+
+  static bool loadTile(FILE *file, const tile_entry_s &entry, MapTile &tile) {
+    tile.resize(entry.count);
+    return fseeko(file, entry.offset, SEEK_SET) == 0 &&
+           fread(tile.data(), sizeof(Map::single_landmark_s), entry.count,
+                 file) == entry.count;
+  }
+
+  void queuePrefetch(const std::vector<uint64_t> &keys) {
+    bool queued = false;
+    {
+      std::lock_guard<std::mutex> cache_lock(cache_mutex);
+      std::lock_guard<std::mutex> queue_lock(queue_mutex);
+      for (size_t t = 0; t < keys.size(); ++t) {
+        if (!cache.count(keys[t]) && !unreadable.count(keys[t]) &&
+            pending.insert(keys[t]).second) {
+          queue.push_back(keys[t]);
+          queued = true;
+        }
+      }
+    }
+    if (queued) {
+      queue_ready.notify_one();
+    }
+  }
+
+  /**
+   * prefetchTile Loads a tile into the cache from the prefetching thread, if
+   *   it is not cached yet, and returns it.
+   */
+  std::shared_ptr<const MapTile> prefetchTile(uint64_t key) {
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      std::unordered_map<uint64_t, CachedTile>::iterator it = cache.find(key);
+      if (it != cache.end()) {
+        return it->second.landmarks;
+      }
+      if (unreadable.count(key)) {
+        return std::make_shared<const MapTile>();
+      }
+    }
+    std::shared_ptr<MapTile> tile = std::make_shared<MapTile>();
+    bool const loaded = loadTile(prefetch_reader, directory.find(key)->second,
+                                 *tile);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!loaded) {
+      return markUnreadable(key);
+    }
+    ++prefetch_loads;
+    return insert(key, tile, 0);
+  }
+
+  /**
+   * buildNext Builds the map of the requested tiles, for update to swap in.
+   */
+  void buildNext(const std::vector<uint64_t> &keys, float cell_size) {
+    std::unique_ptr<Map> next(new Map());
+    for (size_t t = 0; t < keys.size(); ++t) {
+      std::shared_ptr<const MapTile> tile = prefetchTile(keys[t]);
+      next->landmark_list.insert(next->landmark_list.end(), tile->begin(),
+                                 tile->end());
+    }
+    next->buildIdLookup();
+    next->buildIndex(cell_size);
+    size_t const bytes = next->memoryBytes();
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    next.swap(prebuilt);
+    prebuilt_keys = keys;
+    prebuilt_bytes = bytes;
+    ++prebuilt_maps;
+  }
+
+  void prefetchLoop() {
+    std::vector<uint64_t> keys;
+    for (;;) {
+      uint64_t key = 0;
+      bool build = false;
+      float cell_size = 0.0f;
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while (running && queue.empty() && !build_requested) {
+          queue_ready.wait(lock);
+        }
+        if (!running) {
+          return;
+        }
+        // Tiles first, the map of the next tiles needs them
+        if (!queue.empty()) {
+          key = queue.front();
+          queue.pop_front();
+        } else {
+          build = true;
+          keys.swap(build_keys);
+          cell_size = build_cell;
+          build_requested = false;
+        }
+      }
+
+      if (build) {
+        buildNext(keys, cell_size);
+        continue;
+      }
+      prefetchTile(key);
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      pending.erase(key);
+    }
+  }
+
+  double tile_size;
+  size_t memory_budget;
+  float index_cell;
+  FILE *reader;           // Used by update
+  FILE *prefetch_reader;  // Used by the prefetching thread
+  std::unordered_map<uint64_t, tile_entry_s> directory;  // Read-only
+
+  // Active map: the tiles used by the last frame
+  std::atomic<uint64_t> frame;  // Frame counter, read by the prefetcher
+  Map active_map;
+  std::vector<uint64_t> active_keys;
+  std::vector<uint64_t> frame_keys;
+  std::vector<uint64_t> prefetch_keys;
+  std::vector<uint64_t> requested_keys;  // Of the last build request
+  uint64_t sync_loads;
+
+  // LRU tile cache, shared with the prefetching thread, and tiles that
+  // could not be read. The active map counts in the budget too.
+  std::mutex cache_mutex;
+  std::unordered_map<uint64_t, CachedTile> cache;
+  std::list<uint64_t> lru;  // Most recently used first
+  std::unordered_set<uint64_t> unreadable;
+  size_t cache_bytes;
+  size_t active_bytes;
+  uint64_t prefetch_loads;
+
+  // Map of the next tiles, built by the prefetching thread (under
+  // cache_mutex too, it counts in the budget)
+  std::unique_ptr<Map> prebuilt;
+  std::vector<uint64_t> prebuilt_keys;
+  size_t prebuilt_bytes;
+  uint64_t prebuilt_maps;
+  uint64_t prebuilt_swaps;
+
+  // Prefetch queue
+  std::mutex queue_mutex;
+  std::condition_variable queue_ready;
+  std::deque<uint64_t> queue;
+  std::unordered_set<uint64_t> pending;
+  std::vector<uint64_t> build_keys;  // Tiles of the next map to build
+  float build_cell;
+  bool build_requested;
+  bool running;
+  std::thread prefetcher;
+};
+
+#endif  // TILED_MAP_H_
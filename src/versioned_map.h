@@ -0,0 +1,271 @@
+/**
+ * versioned_map.h
+ * Map that can be updated while the filter runs (read-copy-update).
+ *
+ * The map is published as immutable, fully indexed snapshots. A filter pins
+ * the current snapshot for the duration of a frame with two atomic
+ * operations, and never waits. Landmark updates are queued to a background
+ * writer, which builds the next snapshot (landmarks, id lookup and grid
+ * index) off the read path and publishes it. Consecutive snapshots share
+ * the blocks of their grid index and id lookup where no landmark changed.
+ * A retired snapshot is deleted once no reader pinned before its
+ * replacement is still using it.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#ifndef VERSIONED_MAP_H_
+#define VERSIONED_MAP_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "map.h"
+
+/**
+ * Batch of landmark changes, applied atomically.
+ */
+struct landmark_batch_s {
+  std::vector<Map::single_landmark_s> upserts;  // Added or moved landmarks
+  std::vector<int64_t> removals;                // Ids of removed landmarks
+};
+
+class VersionedMap {
+ public:
+  static const int kMaxReaders = 16;
+  static const int kReclaimPeriodMs = 100;
+
+  /**
+   * Constructor Publishes the initial map as the first snapshot.
+   * @param initial Initial map (its id lookup is rebuilt)
+   * @param cell_size Side of the grid index cells of the snapshots [m]
+   */
+  VersionedMap(const Map &initial, float cell_size)
+      : index_cell(cell_size), num_readers(0), version(1), running(true),
+        retired_count(0) {
+    Snapshot *first = new Snapshot(initial, 1);
+    first->map.buildIdLookup();
+    first->map.buildIndex(index_cell);
+    current.store(first);
+    for (int r = 0; r < kMaxReaders; ++r) {
+      pinned[r].store(kIdle);
+    }
+    writer = std::thread(&VersionedMap::writeLoop, this);
+  }
+
+  ~VersionedMap() {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      running = false;
+    }
+    queue_ready.notify_one();
+    writer.join();
+    for (size_t s = 0; s < retired.size(); ++s) {
+      delete retired[s].snapshot;
+    }
+    delete current.load();
+  }
+
+  /**
+   * addReader Registers a reader (a filter) and returns its slot, or -1 if
+   *   all the slots are taken.
+   */
+  int addReader() {
+    int const slot = num_readers.fetch_add(1);
+    return slot < kMaxReaders ? slot : -1;
+  }
+
+  /**
+   * pin Returns the current snapshot, which stays valid until the reader
+   *   calls unpin (or pin again). Lock-free.
+   * @param reader Slot returned by addReader
+   */
+  const Map &pin(int reader) {
+    // Announce the version first: snapshots at least this recent are kept
+    pinned[reader].store(version.load());
+    return current.load()->map;
+  }
+
+  void unpin(int reader) {
+    pinned[reader].store(kIdle);
+  }
+
+  /**
+   * submit Queues a batch of landmark changes for the background writer.
+   */
+  void submit(const landmark_batch_s &batch) {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      batches.push_back(batch);
+    }
+    queue_ready.notify_one();
+  }
+
+  /**
+   * publishedVersion Returns the version of the latest published snapshot.
+   */
+  uint64_t publishedVersion() const {
+    return version.load();
+  }
+
+  /**
+   * retiredSnapshots Returns the number of snapshots waiting to be deleted.
+   */
+  size_t retiredSnapshots() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return retired_count;
+  }
+
+ private:
+  static const uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+
+  struct Snapshot {
+    Snapshot(const Map &m, uint64_t v) : map(m), version(v) {}
+    Map map;
+    uint64_t version;
+  };
+
+  /**
+   * apply Builds the next snapshot from the current one and a batch. The
+   *   landmark list is copied, but removals fill their slot with the last
+   *   landmark instead of shifting the list, so only a few indices change,
+   *   and the blocks of the grid index and of the id lookup without any
+   *   changed landmark are shared with the current snapshot.
+   */
+  Snapshot *apply(const Snapshot &base, const landmark_batch_s &batch,
+                  uint64_t next_version) const {
+    Snapshot *next = new Snapshot(base.map, next_version);
+    std::vector<Map::single_landmark_s> &list = next->map.landmark_list;
+
+    // Indices of the ids moved, added or removed (-1) by this batch so far,
+    // which take precedence over the id lookup of the base: a landmark
+    // upserted twice in a batch is added once
+    std::unordered_map<int64_t, int> moved;
+    std::vector<int> changed;
+    auto index_of = [&](int64_t id) {
+      std::unordered_map<int64_t, int>::const_iterator it = moved.find(id);
+      return it != moved.end() ? it->second : base.map.indexOf(id);
+    };
+
+    for (size_t k = 0; k < batch.removals.size(); ++k) {
+      int const index = index_of(batch.removals[k]);
+      if (index < 0) {
+        continue;
+      }
+      int const last = list.size() - 1;
+      if (index != last) {
+        list[index] = list[last];
+        moved[list[index].id_i] = index;
+      }
+      list.pop_back();
+      moved[batch.removals[k]] = -1;
+      changed.push_back(index);
+      changed.push_back(last);
+    }
+    for (size_t k = 0; k < batch.upserts.size(); ++k) {
+      int index = index_of(batch.upserts[k].id_i);
+      if (index >= 0) {
+        list[index] = batch.upserts[k];
+      } else {
+        index = list.size();
+        list.push_back(batch.upserts[k]);
+        moved[batch.upserts[k].id_i] = index;
+      }
+      changed.push_back(index);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    next->map.updateIdLookup(base.map, changed);
+    if (base.map.hasIndex()) {
+      next->map.updateIndex(base.map, changed);
+    } else {
+      next->map.buildIndex(index_cell);
+    }
+    return next;
+  }
+
+  /**
+   * reclaim Deletes the retired snapshots older than every pinned version.
+   */
+  void reclaim() {
+    uint64_t oldest_pinned = kIdle;
+    for (int r = 0; r < kMaxReaders; ++r) {
+      uint64_t const v = pinned[r].load();
+      if (v < oldest_pinned) {
+        oldest_pinned = v;
+      }
+    }
+    size_t kept = 0;
+    for (size_t s = 0; s < retired.size(); ++s) {
+      // A snapshot replaced at version r is only reachable by the readers
+      // pinned before r
+      if (retired[s].replaced_by <= oldest_pinned) {
+        delete retired[s].snapshot;
+      } else {
+        retired[kept++] = retired[s];
+      }
+    }
+    retired.erase(retired.begin() + kept, retired.end());
+  }
+
+  void writeLoop() {
+    // Copied: binding the constant to the duration's reference parameter
+    // would need an out-of-class definition (unoptimized builds)
+    int const period_ms = kReclaimPeriodMs;
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (running) {
+      if (batches.empty()) {
+        queue_ready.wait_for(lock, std::chrono::milliseconds(period_ms));
+      }
+      while (!batches.empty()) {
+        landmark_batch_s const batch = batches.front();
+        batches.pop_front();
+        lock.unlock();
+
+        Snapshot *const previous = current.load();
+        uint64_t const next_version = previous->version + 1;
+        Snapshot *const next = apply(*previous, batch, next_version);
+        current.store(next);
+        version.store(next_version);
+        retired.push_back(Retired(previous, next_version));
+
+        lock.lock();
+      }
+      lock.unlock();
+      reclaim();
+      lock.lock();
+      retired_count = retired.size();
+    }
+  }
+
+  struct Retired {
+    Retired(Snapshot *s, uint64_t v) : snapshot(s), replaced_by(v) {}
+    Snapshot *snapshot;
+    uint64_t replaced_by;  // Version of the snapshot that replaced it
+  };
+
+  float index_cell;
+  std::atomic<Snapshot *> current;
+  std::atomic<uint64_t> pinned[kMaxReaders];  // Version pinned by each reader
+  std::atomic<int> num_readers;
+  std::atomic<uint64_t> version;              // Latest published version
+  std::vector<Retired> retired;               // Owned by the writer thread
+
+  std::mutex queue_mutex;
+  std::condition_variable queue_ready;
+  std::deque<landmark_batch_s> batches;
+  bool running;
+  size_t retired_count;
+  std::thread writer;
+};
+
+#endif  // VERSIONED_MAP_H_
@@ -0,0 +1,113 @@
+/**
+ * assignment_test.cpp
+ * Hungarian algorithm and the global nearest neighbor association built on
+ * it.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include "assignment.h"
+#include "particle_filter.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {1.0, 1.0};
+
+// Both rows are cheapest on column 0: the optimum gives it to one of them
+// only, and the other row its second choice
+TEST(AssignmentTest, ContestedColumnIsAssignedOnce) {
+  AssignmentSolver solver;
+  solver.resize(2, 3);
+  double const costs[2][3] = {{1.0, 2.0, 9.0}, {1.0, 5.0, 9.0}};
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      solver.cost(i, j) = costs[i][j];
+    }
+  }
+  std::vector<int> row_to_col;
+  solver.solve(row_to_col);
+  ASSERT_EQ(2u, row_to_col.size());
+  EXPECT_EQ(1, row_to_col[0]);
+  EXPECT_EQ(0, row_to_col[1]);
+}
+
+// Associations of a single particle at the origin (observations in vehicle
+// coordinates are then in map coordinates), by observation (-1: outlier)
+std::vector<int64_t> associate(const Map &map,
+                               const std::vector<LandmarkObs> &observations) {
+  ParticleFilter pf;
+  pf.setNumParticles(1);
+  pf.setAssociationGate(13.82, 1e-3);
+  pf.setAssociationMode(GLOBAL_NEAREST_NEIGHBOR);
+  pf.setAssociationRecording(true);
+  pf.init(0.0, 0.0, 0.0, kSigmaPos);
+  pf.particles[0].x = 0.0;
+  pf.particles[0].y = 0.0;
+  pf.particles[0].theta = 0.0;
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+
+  std::vector<int64_t> ids(observations.size(), -1);
+  const Particle &particle = pf.particles[0];
+  const association_s *records = pf.associationRecords(particle);
+  for (uint32_t k = 0; k < particle.associations.count; ++k) {
+    for (size_t j = 0; j < observations.size(); ++j) {
+      if (records[k].sense_x == observations[j].x &&
+          records[k].sense_y == observations[j].y) {
+        ids[j] = records[k].id;
+      }
+    }
+  }
+  return ids;
+}
+
+Map make_map(const std::vector<double> &xs) {
+  Map map;
+  for (size_t k = 0; k < xs.size(); ++k) {
+    Map::single_landmark_s landmark;
+    landmark.id_i = k + 1;
+    landmark.x_f = xs[k];
+    landmark.y_f = 0.0f;
+    map.landmark_list.push_back(landmark);
+  }
+  map.buildIdLookup();
+  return map;
+}
+
+std::vector<LandmarkObs> make_observations(const std::vector<double> &xs) {
+  std::vector<LandmarkObs> observations;
+  for (size_t j = 0; j < xs.size(); ++j) {
+    LandmarkObs obs;
+    obs.id = 0;
+    obs.x = xs[j];
+    obs.y = 0.0;
+    observations.push_back(obs);
+  }
+  return observations;
+}
+
+// Two observations nearest to the same landmark: one gets it, the other
+// one the next landmark, which costs less in total than the reverse
+TEST(AssignmentTest, ContestedLandmarkIsAssignedOnce) {
+  Map const map = make_map({10.0, 12.0});
+  std::vector<int64_t> const ids =
+      associate(map, make_observations({10.0, 10.5}));
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(2, ids[1]);
+}
+
+// The only other landmark is outside the gate of the losing observation
+// (4.8 sigma): it is left unassigned rather than paired with it
+TEST(AssignmentTest, NeverAssignsOutsideTheGate) {
+  Map const map = make_map({10.0, 15.0});
+  std::vector<int64_t> const ids =
+      associate(map, make_observations({10.0, 10.2}));
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(-1, ids[1]);
+}
+
+}  // namespace
@@ -0,0 +1,71 @@
+/**
+ * association_gate_test.cpp
+ * Scoring of the observations gated out by the data association.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+// Weights of a particle on the true pose and of a particle far from every
+// landmark, all of its observations gated out
+void scoreTruthAndLost(ParticleFilter &pf, double weights[2]) {
+  std::default_random_engine gen(7);
+  Map map;
+  make_synthetic_map(400, 400.0, 400.0, gen, map);
+  map.buildIndex(kSensorRange / 2);
+
+  double const x = 200.0, y = 200.0, theta = 0.3;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+  ASSERT_FALSE(observations.empty());
+
+  pf.setNumParticles(2);
+  pf.init(x, y, theta, kSigmaPos);
+  pf.particles[0].x = x;
+  pf.particles[0].y = y;
+  pf.particles[0].theta = theta;
+  pf.particles[1].x = x + 5000.0;
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+  weights[0] = pf.particles[0].weight;
+  weights[1] = pf.particles[1].weight;
+}
+
+// Without an outlier probability, an observation gated out scores the
+// density on the gate boundary, not a free factor of 1
+TEST(AssociationGateTest, GatedOutObservationsNeverOutrankMatches) {
+  double weights[2];
+
+  ParticleFilter nearest;
+  nearest.setAssociationGate(9.21, 0.0);
+  scoreTruthAndLost(nearest, weights);
+  EXPECT_GT(weights[0], weights[1]);
+
+  ParticleFilter global;
+  global.setAssociationGate(9.21, 0.0);
+  global.setAssociationMode(GLOBAL_NEAREST_NEIGHBOR);
+  scoreTruthAndLost(global, weights);
+  EXPECT_GT(weights[0], weights[1]);
+
+  ParticleFilter floored;
+  floored.setAssociationGate(9.21, 0.0);
+  floored.setLikelihoodFloor(50.0);
+  scoreTruthAndLost(floored, weights);
+  EXPECT_GT(weights[0], weights[1]);
+
+  ParticleFilter ungated;
+  scoreTruthAndLost(ungated, weights);
+  EXPECT_GT(weights[0], weights[1]);
+}
+
+}  // namespace
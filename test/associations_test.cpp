@@ -0,0 +1,136 @@
+/**
+ * associations_test.cpp
+ * Debugging associations of the particles.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "filter_setup.h"
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+// captureAssociations, which the server uses for the best particle only,
+// reports the associations updateWeights records for every particle, with
+// the gate and the global nearest neighbor engine
+TEST(AssociationsTest, CaptureMatchesRecordedAssociations) {
+  std::default_random_engine gen(11);
+  Map map;
+  make_synthetic_map(2000, 600.0, 600.0, gen, map);
+
+  ParticleFilter pf;
+  pf.setNumParticles(200);
+  setup_filter(pf, map, kSensorRange);
+  pf.setAssociationMode(GLOBAL_NEAREST_NEIGHBOR);
+  pf.setAssociationRecording(true);
+  pf.seed(5);
+
+  double const x = 300.0, y = 300.0, theta = 0.7;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+  pf.init(x, y, theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+
+  size_t compared = 0;
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    Particle captured = pf.particles[i];
+    pf.captureAssociations(captured, kSensorRange, observations, map);
+
+    const Particle &recorded = pf.particles[i];
+    ASSERT_EQ(recorded.associations.count, captured.associations.count);
+    const association_s *expected = pf.associationRecords(recorded);
+    const association_s *actual = pf.associationRecords(captured);
+    for (uint32_t k = 0; k < recorded.associations.count; ++k) {
+      EXPECT_EQ(expected[k].id, actual[k].id);
+      EXPECT_EQ(expected[k].sense_x, actual[k].sense_x);
+      EXPECT_EQ(expected[k].sense_y, actual[k].sense_y);
+    }
+    compared += recorded.associations.count;
+  }
+  EXPECT_GT(compared, 0u);
+}
+
+// Landmark ids are external: a map whose ids are sparse and use the whole
+// 64 bits gives the same weights and associations (up to the id) as the
+// same map with the dense ids 1..n
+TEST(AssociationsTest, SparseIdsMatchDenseIds) {
+  std::default_random_engine gen(13);
+  Map dense;
+  make_synthetic_map(2000, 600.0, 600.0, gen, dense);
+  Map sparse = dense;
+  std::vector<int64_t> sparse_ids;
+  for (size_t k = 0; k < sparse.landmark_list.size(); ++k) {
+    int64_t const id = INT64_MIN + 1 +
+                       static_cast<int64_t>(k) * 4611686018427387ll;
+    sparse.landmark_list[k].id_i = id;
+    sparse_ids.push_back(id);
+  }
+  sparse.buildIdLookup();
+
+  double const x = 300.0, y = 300.0, theta = -0.4;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      dense, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+
+  ParticleFilter dense_pf, sparse_pf;
+  ParticleFilter *filters[2] = {&dense_pf, &sparse_pf};
+  Map *maps[2] = {&dense, &sparse};
+  for (int f = 0; f < 2; ++f) {
+    filters[f]->setNumParticles(200);
+    setup_filter(*filters[f], *maps[f], kSensorRange);
+    filters[f]->setAssociationRecording(true);
+    filters[f]->seed(5);
+    filters[f]->init(x, y, theta, kSigmaPos);
+    filters[f]->updateWeights(kSensorRange, kSigmaLandmark, observations,
+                              *maps[f]);
+  }
+
+  size_t compared = 0;
+  for (size_t i = 0; i < dense_pf.particles.size(); ++i) {
+    const Particle &d = dense_pf.particles[i];
+    const Particle &s = sparse_pf.particles[i];
+    EXPECT_EQ(d.weight, s.weight);
+    ASSERT_EQ(d.associations.count, s.associations.count);
+    const association_s *expected = dense_pf.associationRecords(d);
+    const association_s *actual = sparse_pf.associationRecords(s);
+    for (uint32_t k = 0; k < d.associations.count; ++k) {
+      ASSERT_GE(expected[k].id, 1);
+      EXPECT_EQ(sparse_ids[expected[k].id - 1], actual[k].id);
+      EXPECT_EQ(expected[k].sense_x, actual[k].sense_x);
+    }
+    compared += d.associations.count;
+  }
+  EXPECT_GT(compared, 0u);
+}
+
+// A span of a previous frame is stale even when the current frame has
+// recorded as many records, and an empty span has none
+TEST(AssociationsTest, SpansOfAnotherFrameAreStale) {
+  AssociationArena arena;
+  EXPECT_TRUE(arena.recordsOf(AssociationSpan()) == NULL);
+
+  uint32_t const first = arena.mark();
+  arena.push(1, 0.5, 0.5);
+  arena.push(2, 1.5, 1.5);
+  AssociationSpan const old_span = arena.spanFrom(first);
+  ASSERT_TRUE(arena.recordsOf(old_span) != NULL);
+
+  arena.reset();
+  uint32_t const next = arena.mark();
+  arena.push(3, 2.5, 2.5);
+  arena.push(4, 3.5, 3.5);
+  AssociationSpan const span = arena.spanFrom(next);
+  EXPECT_TRUE(arena.recordsOf(old_span) == NULL);
+  ASSERT_TRUE(arena.recordsOf(span) != NULL);
+  EXPECT_EQ(3, arena.recordsOf(span)->id);
+}
+
+}  // namespace
@@ -0,0 +1,84 @@
+/**
+ * motion_models_test.cpp
+ * Closed forms of the motion models of the prediction step.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <gtest/gtest.h>
+#include "motion_models.h"
+
+namespace {
+
+// Pose reached by integrating the CTRA model numerically (RK4 on the
+// position, the speed and the heading being linear in time)
+void integrate_ctra(double delta_t, double velocity, double yaw_rate,
+                    double acceleration, double &x, double &y,
+                    double &theta) {
+  int const steps = 10000;
+  double const h = delta_t / steps;
+  double const theta0 = theta;
+  for (int k = 0; k < steps; ++k) {
+    double const t = k * h;
+    double const t_mid = t + 0.5 * h;
+    double const t_end = t + h;
+    double const v0 = velocity + acceleration * t;
+    double const v_mid = velocity + acceleration * t_mid;
+    double const v1 = velocity + acceleration * t_end;
+    double const th0 = theta0 + yaw_rate * t;
+    double const th_mid = theta0 + yaw_rate * t_mid;
+    double const th1 = theta0 + yaw_rate * t_end;
+    x += h / 6.0 * (v0 * cos(th0) + 4.0 * v_mid * cos(th_mid) +
+                    v1 * cos(th1));
+    y += h / 6.0 * (v0 * sin(th0) + 4.0 * v_mid * sin(th_mid) +
+                    v1 * sin(th1));
+  }
+  theta = theta0 + yaw_rate * delta_t;
+}
+
+// Tolerance on the positions (tens of meters) in the precision of the build
+double const kTolerance = sizeof(pf_real) == sizeof(float) ? 1e-4 : 1e-8;
+
+// The closed form of CTRA matches the integration of the model, turning
+// either way, speeding up or slowing down, down to small yaw rates
+TEST(MotionModelsTest, CtraMatchesNumericalIntegration) {
+  double const cases[][5] = {
+      // delta_t, velocity, yaw rate, acceleration, initial heading
+      {0.1, 10.0, 0.3, 2.0, 0.0},
+      {0.1, 10.0, -0.3, -3.0, 1.2},
+      {1.0, 5.0, 0.8, 1.5, -2.5},
+      {1.0, 20.0, -1.5, -4.0, 3.1},
+      {0.5, 15.0, 0.001, 3.0, 0.7},
+      {0.1, 0.0, 0.5, 2.0, -0.4},
+  };
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+    double const *p = cases[c];
+    double x = 10.0, y = -20.0, theta = p[4];
+    integrate_ctra(p[0], p[1], p[2], p[3], x, y, theta);
+
+    pf_real px = 10.0, py = -20.0, ptheta = p[4];
+    CtraMotion::apply(CtraMotion::step(p[0], p[1], p[2], p[3]), px, py,
+                      ptheta);
+    EXPECT_NEAR(x, px, kTolerance) << "case " << c;
+    EXPECT_NEAR(y, py, kTolerance) << "case " << c;
+    EXPECT_NEAR(theta, ptheta, 1e-6) << "case " << c;
+  }
+}
+
+// Without acceleration, CTRA is CTRV, and CTRV tends to the straight line
+// as the yaw rate vanishes (the lateral drift is v yaw_rate delta_t^2 / 2)
+TEST(MotionModelsTest, CtraReducesToCtrvAndStraightLine) {
+  MotionStep const ctra = CtraMotion::step(0.1, 12.0, 0.4, 0.0);
+  MotionStep const ctrv = CtrvMotion::step(0.1, 12.0, 0.4);
+  EXPECT_NEAR(ctrv.forward, ctra.forward, kTolerance);
+  EXPECT_NEAR(ctrv.lateral, ctra.lateral, kTolerance);
+
+  MotionStep const turn = CtrvMotion::step(0.1, 12.0, 10 * kStraightYawRate);
+  MotionStep const straight = StraightLineMotion::step(0.1, 12.0, 0.0);
+  EXPECT_NEAR(straight.forward, turn.forward, kTolerance);
+  EXPECT_NEAR(12.0 * 10 * kStraightYawRate * 0.1 * 0.1 / 2, turn.lateral,
+              1e-9);
+}
+
+}  // namespace
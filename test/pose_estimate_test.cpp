@@ -0,0 +1,46 @@
+/**
+ * pose_estimate_test.cpp
+ * Weighted pose estimate of the particle set.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+// Particles on both sides of the +-pi cut average to a heading on the cut
+// (not to 0), and their yaw spread is the small one around it
+TEST(PoseEstimateTest, CircularMeanWrapsAtPi) {
+  std::default_random_engine gen(4);
+  Map map;
+  make_synthetic_map(100, 200.0, 200.0, gen, map);
+
+  ParticleFilter pf;
+  pf.setNumParticles(100);
+  pf.setPoseEstimation(true);
+  pf.init(100.0, 100.0, M_PI, kSigmaPos);
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    pf.particles[i].x = 100.0;
+    pf.particles[i].y = 100.0;
+    pf.particles[i].theta = i % 2 == 0 ? M_PI - 0.05 : -M_PI + 0.05;
+  }
+  // Without observations, all the particles keep the same weight
+  std::vector<LandmarkObs> const observations;
+  pf.updateWeights(50.0, kSigmaLandmark, observations, map);
+
+  const PoseEstimate &estimate = pf.poseEstimate();
+  EXPECT_NEAR(M_PI, fabs(estimate.theta), 1e-6);
+  EXPECT_NEAR(0.05 * 0.05, estimate.cov[2][2], 1e-6);
+  EXPECT_NEAR(100.0, estimate.x, 1e-6);
+}
+
+}  // namespace
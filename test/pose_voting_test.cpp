@@ -0,0 +1,40 @@
+/**
+ * pose_voting_test.cpp
+ * Index of the landmark pairs of the global initialization.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "pose_voting.h"
+#include "synthetic_world.h"
+
+namespace {
+
+// A non-positive tolerance (or distance) leaves the index empty instead of
+// dividing by it, and the voter then finds no pose
+TEST(PoseVotingTest, RejectsNonPositiveTolerance) {
+  std::default_random_engine gen(5);
+  Map map;
+  make_synthetic_map(200, 300.0, 300.0, gen, map);
+  map.buildIndex(25.0f);
+  double const sigma_landmark[2] = {0.3, 0.3};
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      map, 150.0, 150.0, 0.2, 50.0, sigma_landmark, gen);
+
+  PoseVoter voter;
+  std::vector<PoseCandidate> candidates;
+  EXPECT_FALSE(voter.build(map, 100.0, 0.0));
+  EXPECT_TRUE(voter.empty());
+  EXPECT_FALSE(voter.build(map, 100.0, -1.0));
+  EXPECT_FALSE(voter.build(map, 0.0, 0.85));
+  EXPECT_EQ(0, voter.vote(observations, 5, candidates));
+
+  EXPECT_TRUE(voter.build(map, 100.0, 0.85));
+  EXPECT_FALSE(voter.empty());
+  EXPECT_GT(voter.vote(observations, 5, candidates), 0);
+}
+
+}  // namespace
@@ -0,0 +1,124 @@
+/**
+ * recovery_test.cpp
+ * Kidnap recovery of the particle filter.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "filter_setup.h"
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+// Recovery poses of an auxiliary frame are drawn from the map of that frame,
+// not from the map of the previous frame, which the server may have released
+// (live map updates) by then
+TEST(RecoveryTest, AuxiliaryFrameInjectsFromTheCurrentMap) {
+  std::default_random_engine gen(42);
+  Map *old_map = new Map();
+  make_synthetic_map(400, 400.0, 400.0, gen, *old_map);
+  Map new_map = *old_map;
+
+  ParticleFilter pf;
+  pf.setNumParticles(500);
+  setup_filter(pf, *old_map, kSensorRange);
+  new_map.buildIndex(kSensorRange / 2);
+  pf.setRecovery(UNIFORM_RECOVERY, 0.001, 0.1);
+  pf.seed(1);
+
+  double const x = 200.0, y = 200.0, theta = 0.3;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      *old_map, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+  pf.init(x, y, theta, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, *old_map);
+  for (int frame = 0; frame < 5; ++frame) {
+    pf.auxiliaryUpdate(0.1, kSigmaPos, 0.0, 0.0, kSensorRange,
+                       kSigmaLandmark, observations, *old_map);
+  }
+  // Observations from elsewhere: the short term average drops
+  std::vector<LandmarkObs> elsewhere = make_synthetic_observations(
+      *old_map, 80.0, 320.0, -1.0, kSensorRange, kSigmaLandmark, gen);
+  pf.auxiliaryUpdate(0.1, kSigmaPos, 0.0, 0.0, kSensorRange, kSigmaLandmark,
+                     elsewhere, *old_map);
+  ASSERT_GT(pf.injectionProbability(), 0.0);
+
+  // Map swap: the old map is gone, its memory reused far away
+  for (size_t k = 0; k < old_map->landmark_list.size(); ++k) {
+    old_map->landmark_list[k].x_f += 1e6f;
+  }
+  old_map->buildIndex(kSensorRange / 2);
+  uint64_t const injected = pf.injectedParticles();
+  pf.auxiliaryUpdate(0.1, kSigmaPos, 0.0, 0.0, kSensorRange, kSigmaLandmark,
+                     elsewhere, new_map);
+  delete old_map;
+
+  EXPECT_GT(pf.injectedParticles(), injected);
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    EXPECT_LT(fabs(pf.particles[i].x), 1000.0) << "particle " << i;
+  }
+}
+
+// The recovery poses injected by resample do not carry the associations of
+// the particles they replace, the other particles keep their ancestor's
+TEST(RecoveryTest, InjectedParticlesHaveNoAssociations) {
+  std::default_random_engine gen(8);
+  Map map;
+  make_synthetic_map(400, 400.0, 400.0, gen, map);
+
+  ParticleFilter pf;
+  pf.setNumParticles(500);
+  setup_filter(pf, map, kSensorRange);
+  pf.setRecovery(UNIFORM_RECOVERY, 0.001, 0.1);
+  pf.setAssociationRecording(true);
+  pf.seed(2);
+
+  double const x = 200.0, y = 200.0, theta = 0.3;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+  pf.init(x, y, theta, kSigmaPos);
+  for (int frame = 0; frame < 5; ++frame) {
+    pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+    pf.resample();
+  }
+  // Observations from elsewhere too: the short term average drops, the
+  // particles still record the associations of the others
+  std::vector<LandmarkObs> mixed = make_synthetic_observations(
+      map, 80.0, 320.0, -1.0, kSensorRange, kSigmaLandmark, gen);
+  mixed.insert(mixed.end(), observations.begin(), observations.end());
+  pf.updateWeights(kSensorRange, kSigmaLandmark, mixed, map);
+  ASSERT_GT(pf.injectionProbability(), 0.0);
+
+  std::vector<Particle> const ancestors = pf.particles;
+  uint64_t const injected = pf.injectedParticles();
+  pf.resample();
+  ASSERT_GT(pf.injectedParticles(), injected);
+
+  size_t copies = 0, recovered = 0;
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    const Particle &p = pf.particles[i];
+    bool copy = false;
+    for (size_t a = 0; a < ancestors.size() && !copy; ++a) {
+      copy = ancestors[a].x == p.x && ancestors[a].y == p.y &&
+             ancestors[a].theta == p.theta;
+    }
+    if (copy) {
+      copies += pf.associationRecords(p) != NULL;
+    } else {
+      EXPECT_TRUE(pf.associationRecords(p) == NULL) << "particle " << i;
+      ++recovered;
+    }
+  }
+  EXPECT_GT(copies, 0u);
+  EXPECT_GT(recovered, 0u);
+}
+
+}  // namespace
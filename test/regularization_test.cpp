@@ -0,0 +1,72 @@
+/**
+ * regularization_test.cpp
+ * Kernel jitter of the regularized resampling.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+// Filter whose particles are spread along x and yaw, with y = x + offset
+// (no spread at all across that line if correlated, else no spread in y),
+// resampled with the jitter of a kernel
+void resample_degenerate(RegularizationKernel kernel, bool correlated,
+                         ParticleFilter &pf) {
+  std::default_random_engine gen(6);
+  Map map;
+  make_synthetic_map(100, 200.0, 200.0, gen, map);
+
+  pf.setNumParticles(500);
+  pf.setRegularization(kernel, 1.0);
+  pf.seed(3);
+  pf.init(100.0, 100.0, 0.0, kSigmaPos);
+  std::normal_distribution<double> spread(0.0, 1.0);
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    double const dx = spread(gen);
+    pf.particles[i].x = 100.0 + dx;
+    pf.particles[i].y = correlated ? pf.particles[i].x + 5.0 : 105.0;
+    pf.particles[i].theta = 0.1 * spread(gen);
+  }
+  // Without observations the weights are uniform, the covariance is that of
+  // the particles
+  std::vector<LandmarkObs> const observations;
+  pf.updateWeights(50.0, kSigmaLandmark, observations, map);
+  pf.resample();
+}
+
+// A direction with no spread is not jittered, the others are
+TEST(RegularizationTest, ZeroVarianceDirectionIsNotJittered) {
+  RegularizationKernel const kernels[2] = {GAUSSIAN_KERNEL,
+                                           EPANECHNIKOV_KERNEL};
+  for (int k = 0; k < 2; ++k) {
+    ParticleFilter pf;
+    resample_degenerate(kernels[k], false, pf);
+    EXPECT_GT(pf.separatedDuplicates(), 0u);
+    for (size_t i = 0; i < pf.particles.size(); ++i) {
+      ASSERT_EQ(105.0, pf.particles[i].y);
+    }
+  }
+}
+
+// Same with the direction of no spread across the x and y axes: the
+// jitter keeps the particles on their line
+TEST(RegularizationTest, DegenerateDirectionIsNotJittered) {
+  ParticleFilter pf;
+  resample_degenerate(GAUSSIAN_KERNEL, true, pf);
+  EXPECT_GT(pf.separatedDuplicates(), 0u);
+  for (size_t i = 0; i < pf.particles.size(); ++i) {
+    ASSERT_NEAR(5.0, pf.particles[i].y - pf.particles[i].x, 1e-4);
+  }
+}
+
+}  // namespace
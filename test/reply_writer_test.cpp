@@ -0,0 +1,85 @@
+/**
+ * reply_writer_test.cpp
+ * Number formatting of the replies to the simulator.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stdint.h>
+#include <limits>
+#include <string>
+#include <gtest/gtest.h>
+#include "reply_writer.h"
+
+namespace {
+
+// Text of a number written by the reply writer
+std::string number(double value) {
+  ReplyWriter writer;
+  writer.begin("e");
+  writer.field("v", value);
+  writer.end();
+  std::string const reply(writer.data(), writer.size());
+  std::string const prefix = "42[\"e\",{\"v\":";
+  return reply.substr(prefix.size(), reply.size() - prefix.size() - 2);
+}
+
+// Text of an integer item written by the reply writer
+std::string integer(int64_t value) {
+  ReplyWriter writer;
+  writer.begin("e");
+  writer.beginList("v");
+  writer.item(value);
+  writer.endList();
+  writer.end();
+  std::string const reply(writer.data(), writer.size());
+  std::string const prefix = "42[\"e\",{\"v\":\"";
+  return reply.substr(prefix.size(), reply.size() - prefix.size() - 3);
+}
+
+TEST(ReplyWriterTest, WritesZeroAndNegatives) {
+  EXPECT_EQ("0", number(0.0));
+  EXPECT_EQ("0", number(-0.0));
+  EXPECT_EQ("-1.5", number(-1.5));
+  EXPECT_EQ("-123456.789", number(-123456.789));
+  EXPECT_EQ("-0.001", number(-0.001));
+}
+
+TEST(ReplyWriterTest, SwitchesToScientificNotationOutsideFixedRange) {
+  EXPECT_EQ("0.00001", number(1e-5));
+  EXPECT_EQ("9.99e-6", number(9.99e-6));
+  EXPECT_EQ("9999999999", number(9999999999.0));
+  EXPECT_EQ("1e10", number(1e10));
+  EXPECT_EQ("-1.5e15", number(-1.5e15));
+}
+
+TEST(ReplyWriterTest, RoundsToTenSignificantDigits) {
+  EXPECT_EQ("3.141592654", number(3.14159265358979));
+  EXPECT_EQ("10", number(9.9999999999));
+  EXPECT_EQ("1", number(0.99999999999));
+  EXPECT_EQ("1e10", number(9999999999.9));
+}
+
+TEST(ReplyWriterTest, WritesExtremeMagnitudes) {
+  EXPECT_EQ("4.940656458e-324",
+            number(std::numeric_limits<double>::denorm_min()));
+  EXPECT_EQ("2.225073859e-308", number(std::numeric_limits<double>::min()));
+  EXPECT_EQ("1.797693135e308", number(std::numeric_limits<double>::max()));
+}
+
+TEST(ReplyWriterTest, WritesNonFiniteValuesAsNull) {
+  EXPECT_EQ("null", number(std::numeric_limits<double>::quiet_NaN()));
+  EXPECT_EQ("null", number(std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("null", number(-std::numeric_limits<double>::infinity()));
+}
+
+TEST(ReplyWriterTest, WritesLargeIntegerIds) {
+  EXPECT_EQ("0", integer(0));
+  EXPECT_EQ("-42", integer(-42));
+  EXPECT_EQ("9223372036854775807",
+            integer(std::numeric_limits<int64_t>::max()));
+  EXPECT_EQ("-9223372036854775808",
+            integer(std::numeric_limits<int64_t>::min()));
+}
+
+}  // namespace
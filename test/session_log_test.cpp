@@ -0,0 +1,91 @@
+/**
+ * session_log_test.cpp
+ * Recording and reading back of session logs.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "session_log.h"
+
+namespace {
+
+// The server only exits through a signal, so the recorder is never
+// destroyed: every frame must reach the file as soon as it is recorded
+TEST(SessionLogTest, FramesAreReadableBeforeTheRecorderCloses) {
+  std::string const filename = "pf_test_session.pfsl";
+  session_header_s header = session_header_s();
+  header.seed = 7;
+  header.num_particles = 100;
+
+  SessionRecorder recorder;
+  ASSERT_TRUE(recorder.open(filename, header));
+  std::vector<LandmarkObs> observations(3);
+  for (size_t i = 0; i < observations.size(); ++i) {
+    observations[i].id = 0;
+    observations[i].x = 1.5 * i;
+    observations[i].y = -2.0 * i;
+  }
+  recorder.record(session_frame_s::INIT, 1.0, 2.0, 0.5, observations);
+  recorder.record(session_frame_s::PREDICTION, 3.0, 0.1, 0.0, observations);
+
+  // Read while the recorder is still open
+  SessionReader reader;
+  session_header_s read_header;
+  ASSERT_TRUE(reader.open(filename, read_header));
+  EXPECT_EQ(7u, read_header.seed);
+  EXPECT_EQ(100u, read_header.num_particles);
+  session_frame_s frame;
+  ASSERT_TRUE(reader.next(frame));
+  EXPECT_EQ(static_cast<uint32_t>(session_frame_s::INIT), frame.kind);
+  EXPECT_EQ(2.0, frame.control[1]);
+  ASSERT_TRUE(reader.next(frame));
+  EXPECT_EQ(static_cast<uint32_t>(session_frame_s::PREDICTION), frame.kind);
+  ASSERT_EQ(3u, frame.observations.size());
+  EXPECT_EQ(-4.0, frame.observations[2].y);
+  EXPECT_FALSE(reader.next(frame));
+
+  recorder.close();
+  remove(filename.c_str());
+}
+
+// The header is written raw: whatever the padding of the caller's header
+// holds, the padding bytes in the file are zero
+TEST(SessionLogTest, HeaderPaddingIsZeroed) {
+  std::string const filename = "pf_test_header.pfsl";
+  session_header_s header;
+  memset(&header, 0xAB, sizeof(header));
+  header.seed = 7;
+  header.delta_t = 0.1;
+
+  SessionRecorder recorder;
+  ASSERT_TRUE(recorder.open(filename, header));
+  recorder.close();
+
+  unsigned char bytes[sizeof(session_header_s)];
+  FILE *file = fopen(filename.c_str(), "rb");
+  ASSERT_TRUE(file != NULL);
+  ASSERT_EQ(1u, fread(bytes, sizeof(bytes), 1, file));
+  fclose(file);
+  remove(filename.c_str());
+
+  // Padding between the seed and delta_t
+  size_t const seed_end = offsetof(session_header_s, seed) + sizeof(uint32_t);
+  ASSERT_LT(seed_end, offsetof(session_header_s, delta_t));
+  for (size_t k = seed_end; k < offsetof(session_header_s, delta_t); ++k) {
+    EXPECT_EQ(0, bytes[k]) << "byte " << k;
+  }
+  // Tail padding after the last field
+  size_t const last_end = offsetof(session_header_s, global_init) +
+                          sizeof(uint32_t);
+  for (size_t k = last_end; k < sizeof(bytes); ++k) {
+    EXPECT_EQ(0, bytes[k]) << "byte " << k;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,159 @@
+/**
+ * static_particle_filter_test.cpp
+ * StaticParticleFilter against the default pipeline of ParticleFilter.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "particle_filter.h"
+#include "static_particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+double kSigmaLandmark[2] = {0.3, 0.3};
+
+typedef StaticParticleFilter<BicycleMotion, GaussianMeasurement,
+                             WheelResampler, 200> SmallStaticParticleFilter;
+
+// Same seed, same frames: the default pipelines of both filters draw the
+// same random numbers and compute the same weights
+TEST(StaticParticleFilterTest, MatchesTheDefaultParticleFilter) {
+  std::default_random_engine gen(42);
+  Map map;
+  make_synthetic_map(2000, 600.0, 600.0, gen, map);
+  map.buildIndex(kSensorRange / 2);
+
+  ParticleFilter pf;
+  pf.setNumParticles(SmallStaticParticleFilter::num_particles);
+  std::unique_ptr<SmallStaticParticleFilter> spf(
+      new SmallStaticParticleFilter());
+
+  double x = 300.0, y = 300.0, theta = 0.3;
+  pf.init(x, y, theta, kSigmaPos);
+  spf->init(x, y, theta, kSigmaPos);
+  double const velocity = 5.0;
+  for (int frame = 0; frame < 20; ++frame) {
+    double const yaw_rate = frame < 10 ? 0.0 : 0.2;
+    if (frame > 0) {
+      pf.prediction(0.1, kSigmaPos, velocity, yaw_rate);
+      spf->prediction(0.1, kSigmaPos, velocity, yaw_rate);
+      if (yaw_rate == 0.0) {
+        x += velocity * 0.1 * cos(theta);
+        y += velocity * 0.1 * sin(theta);
+      } else {
+        x += velocity / yaw_rate * (sin(theta + yaw_rate * 0.1) - sin(theta));
+        y += velocity / yaw_rate * (cos(theta) - cos(theta + yaw_rate * 0.1));
+        theta += yaw_rate * 0.1;
+      }
+    }
+    std::vector<LandmarkObs> observations = make_synthetic_observations(
+        map, x, y, theta, kSensorRange, kSigmaLandmark, gen);
+    pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+    spf->updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+
+    for (size_t i = 0; i < SmallStaticParticleFilter::num_particles; ++i) {
+      ASSERT_EQ(pf.particles[i].x, spf->particles[i].x)
+          << "frame " << frame << " particle " << i;
+      ASSERT_EQ(pf.particles[i].y, spf->particles[i].y);
+      ASSERT_EQ(pf.particles[i].theta, spf->particles[i].theta);
+      ASSERT_EQ(pf.particles[i].weight, spf->particles[i].weight)
+          << "frame " << frame << " particle " << i;
+    }
+    pf.resample();
+    spf->resample();
+  }
+}
+
+// Map of a few landmarks, given as x, y pairs
+void make_sparse_map(const std::vector<float> &positions, Map &map) {
+  map.landmark_list.clear();
+  Map::single_landmark_s landmark;
+  for (size_t k = 0; k + 1 < positions.size(); k += 2) {
+    landmark.id_i = k / 2 + 1;
+    landmark.x_f = positions[k];
+    landmark.y_f = positions[k + 1];
+    map.landmark_list.push_back(landmark);
+  }
+  map.buildIdLookup();
+  map.buildIndex(kSensorRange / 2);
+}
+
+// On a sparse map, the particles without any landmark in range score their
+// observations as outliers, like ParticleFilter, instead of a zero weight
+TEST(StaticParticleFilterTest, ScoresObservationsWithoutLandmarkAsOutliers) {
+  // A single landmark near the sensor range from the vehicle: about half
+  // of the particles do not have it in range
+  Map map;
+  make_sparse_map({0.0f, 0.0f, 350.0f, 300.0f, 600.0f, 600.0f}, map);
+  std::vector<LandmarkObs> observations(1);
+  observations[0].x = 50.0;
+  observations[0].y = 0.0;
+  observations[0].id = -1;
+
+  ParticleFilter pf;
+  pf.setNumParticles(SmallStaticParticleFilter::num_particles);
+  std::unique_ptr<SmallStaticParticleFilter> spf(
+      new SmallStaticParticleFilter());
+  pf.init(300.0, 300.0, 0.0, kSigmaPos);
+  spf->init(300.0, 300.0, 0.0, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+  spf->updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+
+  size_t outliers = 0;
+  for (size_t i = 0; i < SmallStaticParticleFilter::num_particles; ++i) {
+    const ParticleState &p = spf->particles[i];
+    ASSERT_EQ(pf.particles[i].weight, p.weight) << "particle " << i;
+    EXPECT_GT(p.weight, 0.0);
+    if (dist(p.x, p.y, 350.0, 300.0) > kSensorRange) {
+      ++outliers;
+    }
+  }
+  size_t const num_particles = SmallStaticParticleFilter::num_particles;
+  EXPECT_GT(outliers, 0u);
+  EXPECT_LT(outliers, num_particles);
+}
+
+// With many observations and no landmark in range of any particle, the
+// product of the outlier likelihoods underflows: the weights are left
+// uniform instead of NaN, and resampling still works
+TEST(StaticParticleFilterTest, UniformWeightsWhenAllLikelihoodsUnderflow) {
+  Map map;
+  make_sparse_map({0.0f, 0.0f, 600.0f, 600.0f}, map);
+  std::vector<LandmarkObs> observations(200);
+  for (size_t j = 0; j < observations.size(); ++j) {
+    observations[j].x = 10.0 + 0.1 * j;
+    observations[j].y = 0.0;
+    observations[j].id = -1;
+  }
+
+  ParticleFilter pf;
+  pf.setNumParticles(SmallStaticParticleFilter::num_particles);
+  std::unique_ptr<SmallStaticParticleFilter> spf(
+      new SmallStaticParticleFilter());
+  pf.init(300.0, 300.0, 0.0, kSigmaPos);
+  spf->init(300.0, 300.0, 0.0, kSigmaPos);
+  pf.updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+  spf->updateWeights(kSensorRange, kSigmaLandmark, observations, map);
+
+  double const uniform = 1.0 / SmallStaticParticleFilter::num_particles;
+  for (size_t i = 0; i < SmallStaticParticleFilter::num_particles; ++i) {
+    ASSERT_EQ(pf.particles[i].weight, spf->particles[i].weight);
+    EXPECT_EQ(uniform, spf->particles[i].weight);
+  }
+
+  spf->resample();
+  for (size_t i = 0; i < SmallStaticParticleFilter::num_particles; ++i) {
+    EXPECT_TRUE(std::isfinite(spf->particles[i].x));
+    EXPECT_EQ(uniform, spf->particles[i].weight);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,42 @@
+/**
+ * synthetic_world_test.cpp
+ * Sensor simulation of the synthetic worlds.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "synthetic_world.h"
+
+namespace {
+
+// The grid index finds the same landmarks as the scan of the whole map, in
+// the same order, so the observations (and their noise) are the same
+TEST(SyntheticWorldTest, IndexedMapGivesTheSameObservations) {
+  std::default_random_engine gen(11);
+  Map scanned;
+  make_synthetic_map(3000, 600.0, 400.0, gen, scanned);
+  Map indexed = scanned;
+  indexed.buildIndex(25.0f);
+
+  double const sigma_landmark[2] = {0.3, 0.3};
+  std::uniform_real_distribution<double> dist_x(-50.0, 650.0);
+  std::uniform_real_distribution<double> dist_y(-50.0, 450.0);
+  for (int q = 0; q < 50; ++q) {
+    double const x = dist_x(gen), y = dist_y(gen), theta = 0.1 * q;
+    std::default_random_engine noise_scanned(q), noise_indexed(q);
+    std::vector<LandmarkObs> const expected = make_synthetic_observations(
+        scanned, x, y, theta, 50.0, sigma_landmark, noise_scanned);
+    std::vector<LandmarkObs> const observations = make_synthetic_observations(
+        indexed, x, y, theta, 50.0, sigma_landmark, noise_indexed);
+    ASSERT_EQ(expected.size(), observations.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+      EXPECT_EQ(expected[j].x, observations[j].x);
+      EXPECT_EQ(expected[j].y, observations[j].y);
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,151 @@
+/**
+ * tiled_map_test.cpp
+ * Streaming of a tiled map with unreadable tiles.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "helper_functions.h"
+#include "synthetic_world.h"
+#include "tiled_map.h"
+
+namespace {
+
+// A tile that cannot be read (here, truncated) is left out of the active
+// map and of the cache, and is not loaded again
+TEST(TiledMapTest, UnreadableTilesAreNotCached) {
+  std::string const filename = "pf_test_tiles.pftm";
+  std::default_random_engine gen(3);
+  Map map;
+  make_synthetic_map(400, 200.0, 200.0, gen, map);
+  ASSERT_TRUE(write_tiled_map(map, 100.0, filename));
+
+  // Drop the second half of the last tile of the file
+  FILE *file = fopen(filename.c_str(), "rb");
+  ASSERT_TRUE(file != NULL);
+  fseeko(file, 0, SEEK_END);
+  off_t const size = ftello(file);
+  fclose(file);
+  ASSERT_EQ(0, truncate(filename.c_str(),
+                        size - 5 * sizeof(Map::single_landmark_s)));
+
+  TiledMapStore store;
+  ASSERT_TRUE(store.open(filename, 1 << 20));
+  const Map &active = store.update(0.0, 0.0, 199.0, 199.0, 0.0, 0.0, 0.0);
+  size_t const resident = active.landmark_list.size();
+  EXPECT_GT(resident, 0u);
+  EXPECT_LT(resident, map.landmark_list.size());
+  uint64_t const loads = store.syncLoads();
+
+  // Same tiles after a frame elsewhere: nothing is read again
+  store.update(1000.0, 1000.0, 1001.0, 1001.0, 0.0, 0.0, 0.0);
+  const Map &again = store.update(0.0, 0.0, 199.0, 199.0, 0.0, 0.0, 0.0);
+  EXPECT_EQ(resident, again.landmark_list.size());
+  EXPECT_EQ(loads, store.syncLoads());
+
+  store.close();
+  remove(filename.c_str());
+}
+
+// Contents of a file
+std::string file_bytes(const std::string &filename) {
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+// The streaming converter, with buckets much smaller than the map, writes
+// the same file as write_tiled_map from the loaded map
+TEST(TiledMapTest, StreamingConversionMatchesInMemoryConversion) {
+  std::string const map_file = "pf_test_map.txt";
+  std::string const expected_file = "pf_test_expected.pftm";
+  std::string const converted_file = "pf_test_converted.pftm";
+  std::default_random_engine gen(8);
+  Map synthetic;
+  make_synthetic_map(3000, 1200.0, 900.0, gen, synthetic);
+  FILE *text = fopen(map_file.c_str(), "w");
+  ASSERT_TRUE(text != NULL);
+  for (size_t k = 0; k < synthetic.landmark_list.size(); ++k) {
+    // Around the origin, for tiles of negative coordinates too
+    fprintf(text, "%.4f\t%.4f\t%lld\n",
+            synthetic.landmark_list[k].x_f - 600.0,
+            synthetic.landmark_list[k].y_f - 450.0,
+            static_cast<long long>(synthetic.landmark_list[k].id_i));
+  }
+  fclose(text);
+
+  Map map;
+  ASSERT_TRUE(read_map_data(map_file, map));
+  ASSERT_TRUE(write_tiled_map(map, 100.0, expected_file));
+  size_t num_landmarks = 0;
+  ASSERT_TRUE(convert_tiled_map(map_file, 100.0, converted_file,
+                                4096, num_landmarks));
+  EXPECT_EQ(map.landmark_list.size(), num_landmarks);
+  std::string const expected = file_bytes(expected_file);
+  EXPECT_GT(expected.size(), num_landmarks * sizeof(Map::single_landmark_s));
+  EXPECT_TRUE(expected == file_bytes(converted_file));
+
+  remove(map_file.c_str());
+  remove(expected_file.c_str());
+  remove(converted_file.c_str());
+}
+
+// Sorted ids of the landmarks of a map
+std::vector<int64_t> sorted_ids(const Map &map) {
+  std::vector<int64_t> ids;
+  for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+    ids.push_back(map.landmark_list[k].id_i);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Driving towards the next tiles, the map of these tiles is built in the
+// background and swapped in when the area reaches them, without loading
+// tiles on the event loop, and equals the map built synchronously
+TEST(TiledMapTest, SwapsInTheMapBuiltInTheBackground) {
+  std::string const filename = "pf_test_prebuilt.pftm";
+  std::default_random_engine gen(5);
+  Map map;
+  make_synthetic_map(4000, 1000.0, 200.0, gen, map);
+  ASSERT_TRUE(write_tiled_map(map, 100.0, filename));
+
+  TiledMapStore store;
+  ASSERT_TRUE(store.open(filename, 16 << 20));
+  store.update(10.0, 10.0, 150.0, 150.0, 0.0, 20.0, 5.0);
+  for (int k = 0; k < 5000 && store.prebuiltMaps() == 0; ++k) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(1u, store.prebuiltMaps());
+  uint64_t const loads = store.syncLoads();
+
+  const Map &active = store.update(60.0, 10.0, 210.0, 150.0, 0.0, 20.0, 5.0);
+  EXPECT_EQ(1u, store.prebuiltSwaps());
+  EXPECT_EQ(loads, store.syncLoads());
+  EXPECT_TRUE(active.hasIndex());
+
+  TiledMapStore reference;
+  ASSERT_TRUE(reference.open(filename, 16 << 20));
+  const Map &expected = reference.update(60.0, 10.0, 210.0, 150.0, 0.0, 0.0,
+                                         0.0);
+  EXPECT_GT(expected.landmark_list.size(), 0u);
+  EXPECT_EQ(sorted_ids(expected), sorted_ids(active));
+  EXPECT_EQ(0u, reference.prebuiltSwaps());
+
+  store.close();
+  reference.close();
+  remove(filename.c_str());
+}
+
+}  // namespace
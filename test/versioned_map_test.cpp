@@ -0,0 +1,131 @@
+/**
+ * versioned_map_test.cpp
+ * Snapshots of the map updated while the filter runs.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "synthetic_world.h"
+#include "versioned_map.h"
+
+namespace {
+
+float const kCellSize = 25.0f;
+
+Map::single_landmark_s landmark(int64_t id, float x, float y) {
+  Map::single_landmark_s l;
+  l.id_i = id;
+  l.x_f = x;
+  l.y_f = y;
+  return l;
+}
+
+// Waits for the writer to publish a version
+void wait_for_version(const VersionedMap &live, uint64_t version) {
+  while (live.publishedVersion() < version) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// Checks the id lookup and the grid index of a snapshot against its list
+void expect_consistent(const Map &map, std::default_random_engine &gen) {
+  for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+    ASSERT_EQ(static_cast<int>(k), map.indexOf(map.landmark_list[k].id_i));
+  }
+
+  std::uniform_real_distribution<double> dist_pos(-150.0, 550.0);
+  double const range = 60.0;
+  for (int q = 0; q < 200; ++q) {
+    double const x = dist_pos(gen), y = dist_pos(gen);
+    std::vector<int> expected, visited;
+    for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+      if (dist(x, y, map.landmark_list[k].x_f, map.landmark_list[k].y_f) <=
+          range) {
+        expected.push_back(k);
+      }
+    }
+    map.forEachInRange(x, y, range, [&](const Map::cell_landmark_s &l) {
+      EXPECT_EQ(map.landmark_list[l.index].x_f, l.x_f);
+      EXPECT_EQ(map.landmark_list[l.index].y_f, l.y_f);
+      if (dist(x, y, l.x_f, l.y_f) <= range) {
+        visited.push_back(l.index);
+      }
+    });
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(expected, visited) << "query " << x << ", " << y;
+  }
+}
+
+// Moves, removals and additions (also outside the original bounds, which
+// grows the grid) leave each snapshot with an index and an id lookup equal
+// to those of its landmark list, as built from scratch
+TEST(VersionedMapTest, SnapshotsMatchTheirLandmarks) {
+  std::default_random_engine gen(7);
+  Map initial;
+  make_synthetic_map(1500, 400.0, 400.0, gen, initial);
+  VersionedMap live(initial, kCellSize);
+  int const reader = live.addReader();
+
+  std::uniform_real_distribution<float> dist_pos(-100.0f, 500.0f);
+  std::uniform_int_distribution<int64_t> dist_id(1, 1600);
+  uint64_t version = live.publishedVersion();
+  for (int b = 0; b < 20; ++b) {
+    landmark_batch_s batch;
+    for (int k = 0; k < 20; ++k) {
+      batch.upserts.push_back(landmark(dist_id(gen), dist_pos(gen),
+                                       dist_pos(gen)));
+      batch.removals.push_back(dist_id(gen));
+    }
+    live.submit(batch);
+    wait_for_version(live, ++version);
+
+    const Map &map = live.pin(reader);
+    expect_consistent(map, gen);
+    live.unpin(reader);
+  }
+}
+
+// A new id upserted several times in one batch is added once, at its last
+// position, and an id removed and upserted in the same batch is re-added
+TEST(VersionedMapTest, DeduplicatesIdsWithinABatch) {
+  std::default_random_engine gen(3);
+  Map initial;
+  make_synthetic_map(100, 200.0, 200.0, gen, initial);
+  VersionedMap live(initial, kCellSize);
+  int const reader = live.addReader();
+
+  landmark_batch_s batch;
+  batch.upserts.push_back(landmark(1000, 10.0f, 10.0f));
+  batch.upserts.push_back(landmark(1000, 20.0f, 30.0f));
+  batch.removals.push_back(5);
+  batch.upserts.push_back(landmark(5, 50.0f, 60.0f));
+  live.submit(batch);
+  wait_for_version(live, 2);
+
+  const Map &map = live.pin(reader);
+  EXPECT_EQ(101u, map.landmark_list.size());
+  int count = 0;
+  for (size_t k = 0; k < map.landmark_list.size(); ++k) {
+    count += map.landmark_list[k].id_i == 1000;
+  }
+  EXPECT_EQ(1, count);
+  int const added = map.indexOf(1000);
+  ASSERT_GE(added, 0);
+  EXPECT_EQ(20.0f, map.landmark_list[added].x_f);
+  EXPECT_EQ(30.0f, map.landmark_list[added].y_f);
+  int const readded = map.indexOf(5);
+  ASSERT_GE(readded, 0);
+  EXPECT_EQ(50.0f, map.landmark_list[readded].x_f);
+  expect_consistent(map, gen);
+  live.unpin(reader);
+}
+
+}  // namespace
@@ -0,0 +1,147 @@
+/**
+ * weights_test.cpp
+ * Particle weights of the measurement update.
+ *
+ * Created on: Oct 18, 2026
+ */
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "filter_setup.h"
+#include "particle_filter.h"
+#include "synthetic_world.h"
+
+namespace {
+
+double const kSensorRange = 50.0;
+double kSigmaPos[3] = {0.3, 0.3, 0.01};
+
+// With a coarse sensor and many observations, the likelihood of even the
+// best particle is far below the smallest float: the weights still rank the
+// particles in the single precision build
+TEST(WeightsTest, SmallLikelihoodsDoNotUnderflow) {
+  std::default_random_engine gen(9);
+  Map map;
+  make_synthetic_map(2000, 400.0, 400.0, gen, map);
+  map.buildIndex(kSensorRange / 2);
+
+  double sigma_landmark[2] = {3.0, 3.0};
+  double const x = 200.0, y = 200.0, theta = 0.1;
+  std::vector<LandmarkObs> observations = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, sigma_landmark, gen);
+  ASSERT_GT(observations.size(), 30u);
+
+  ParticleFilter pf;
+  pf.setNumParticles(2);
+  pf.init(x, y, theta, kSigmaPos);
+  pf.particles[0].x = x;
+  pf.particles[0].y = y;
+  pf.particles[0].theta = theta;
+  pf.particles[1] = pf.particles[0];
+  pf.particles[1].x += 2.0;
+  pf.updateWeights(kSensorRange, sigma_landmark, observations, map);
+
+  EXPECT_GT(pf.particles[0].weight, 0.9);
+  EXPECT_LT(pf.particles[1].weight, 0.1);
+}
+
+// Deduplicating bit-identical particles (the copies drawn by resample)
+// changes neither the weights nor the associations, only how many
+// particles are scored
+TEST(WeightsTest, DeduplicationMatchesFullEvaluation) {
+  std::default_random_engine gen(21);
+  Map map;
+  make_synthetic_map(2000, 400.0, 400.0, gen, map);
+  double sigma_landmark[2] = {0.3, 0.3};
+  double const x = 200.0, y = 200.0, theta = -0.3;
+  std::vector<LandmarkObs> first = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, sigma_landmark, gen);
+  std::vector<LandmarkObs> second = make_synthetic_observations(
+      map, x, y, theta, kSensorRange, sigma_landmark, gen);
+
+  ParticleFilter full, deduplicated;
+  ParticleFilter *filters[2] = {&full, &deduplicated};
+  for (int f = 0; f < 2; ++f) {
+    filters[f]->setNumParticles(300);
+    setup_filter(*filters[f], map, kSensorRange);
+    filters[f]->setAssociationRecording(true);
+    filters[f]->seed(8);
+    filters[f]->init(x, y, theta, kSigmaPos);
+    filters[f]->updateWeights(kSensorRange, sigma_landmark, first, map);
+    filters[f]->resample();
+  }
+  setup_deduplication(deduplicated, 0.0, kSensorRange);
+  for (int f = 0; f < 2; ++f) {
+    filters[f]->updateWeights(kSensorRange, sigma_landmark, second, map);
+  }
+  EXPECT_GT(deduplicated.likelihoodReuses(), 0u);
+
+  for (size_t i = 0; i < full.particles.size(); ++i) {
+    const Particle &a = full.particles[i];
+    const Particle &b = deduplicated.particles[i];
+    ASSERT_EQ(a.x, b.x);
+    EXPECT_EQ(a.weight, b.weight);
+    ASSERT_EQ(a.associations.count, b.associations.count);
+    const association_s *expected = full.associationRecords(a);
+    const association_s *actual = deduplicated.associationRecords(b);
+    for (uint32_t k = 0; k < a.associations.count; ++k) {
+      EXPECT_EQ(expected[k].id, actual[k].id);
+      EXPECT_EQ(expected[k].sense_x, actual[k].sense_x);
+    }
+  }
+}
+
+// Index of the particle of highest weight
+size_t best_particle(const ParticleFilter &pf) {
+  size_t best = 0;
+  for (size_t i = 1; i < pf.particles.size(); ++i) {
+    if (pf.particles[i].weight > pf.particles[best].weight) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// The early termination below the likelihood floor, even with a narrow
+// margin that terminates most particles, never drops or changes the best
+// particle
+TEST(WeightsTest, LikelihoodFloorKeepsTheBestParticle) {
+  std::default_random_engine gen(17);
+  Map map;
+  make_synthetic_map(3000, 500.0, 500.0, gen, map);
+  double sigma_landmark[2] = {0.3, 0.3};
+  double sigma_init[3] = {1.0, 1.0, 0.05};
+  std::uniform_real_distribution<double> dist_pos(100.0, 400.0);
+
+  uint64_t terminated = 0;
+  for (int trial = 0; trial < 20; ++trial) {
+    double const x = dist_pos(gen), y = dist_pos(gen), theta = 0.3 * trial;
+    std::vector<LandmarkObs> observations = make_synthetic_observations(
+        map, x, y, theta, kSensorRange, sigma_landmark, gen);
+
+    ParticleFilter full, floored;
+    ParticleFilter *filters[2] = {&full, &floored};
+    for (int f = 0; f < 2; ++f) {
+      filters[f]->setNumParticles(300);
+      setup_filter(*filters[f], map, kSensorRange);
+      filters[f]->seed(trial);
+      filters[f]->init(x, y, theta, sigma_init);
+    }
+    full.setLikelihoodFloor(0.0);
+    floored.setLikelihoodFloor(2.0);
+    for (int f = 0; f < 2; ++f) {
+      filters[f]->updateWeights(kSensorRange, sigma_landmark, observations,
+                                map);
+    }
+
+    size_t const best = best_particle(full);
+    EXPECT_EQ(best, best_particle(floored)) << "trial " << trial;
+    EXPECT_GT(floored.particles[best].weight, 0.0);
+    terminated += floored.terminatedParticles();
+  }
+  EXPECT_GT(terminated, 0u);
+}
+
+}  // namespace